@@ -7,6 +7,9 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "devices/disk.h"
+#ifdef VM
+#include "filesys/page_cache.h"
+#endif
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
@@ -22,6 +25,9 @@ filesys_init (bool format) {
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
 	inode_init ();
+#ifdef VM
+	page_cache_init ();
+#endif
 
 #ifdef EFILESYS
 	fat_init ();
@@ -46,6 +52,9 @@ filesys_init (bool format) {
  * to disk. */
 void
 filesys_done (void) {
+#ifdef VM
+	page_cache_flush ();
+#endif
 	/* Original FS */
 #ifdef EFILESYS
 	fat_close ();
@@ -6,8 +6,11 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
-#ifdef
-	"filesys/fat.c"
+#ifdef VM
+#include "filesys/page_cache.h"
+#endif
+#ifdef EFILESYS
+#include "filesys/fat.h"
 #endif
 
 /* Identifies an inode. */
@@ -36,6 +39,7 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	int map_cnt;                        /* Number of mmap()s of it. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -46,7 +50,7 @@ struct inode {
 static disk_sector_t
 byte_to_sector (const struct inode *inode, off_t pos) {
 	ASSERT (inode != NULL);
-	if (pos < inode->data.length)
+	if (pos < inode->data.length) {
 		#ifdef EFILESYS
 			cluster_t clst = inode->data.start - fat_fs->data_start + 1;
 			for (unsigned i = 0; i < (pos / DISK_SECTOR_SIZE); i++){
@@ -186,6 +190,7 @@ inode_open (disk_sector_t sector) {
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
+	inode->map_cnt = 0;
 	inode->removed = false;
 	disk_read (filesys_disk, inode->sector, &inode->data);
 	
@@ -217,6 +222,10 @@ inode_close (struct inode *inode) {
 
 	/* Release resources if this was the last opener. */
 	if (--inode->open_cnt == 0) {
+#ifdef VM
+		/* Data of a removed file need not reach the disk. */
+		page_cache_drop (inode, !inode->removed);
+#endif
 		/* Remove from inode list and release lock. */
 		list_remove (&inode->elem);
 
@@ -244,6 +253,35 @@ inode_remove (struct inode *inode) {
  * than SIZE if an error occurs or end of file is reached. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
+#ifdef VM
+	return page_cache_read (inode, buffer_, size, offset);
+#else
+	return inode_read_direct (inode, buffer_, size, offset);
+#endif
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+ * Returns the number of bytes actually written, which may be
+ * less than SIZE if end of file is reached or an error occurs.
+ * (Normally a write at end of file would extend the inode, but
+ * growth is not yet implemented.) */
+off_t
+inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+		off_t offset) {
+	if (inode->deny_write_cnt)
+		return 0;
+#ifdef VM
+	return page_cache_write (inode, buffer_, size, offset);
+#else
+	return inode_write_direct (inode, buffer_, size, offset);
+#endif
+}
+
+/* Reads like inode_read_at(), but straight from the disk, bypassing
+ * the page cache. */
+off_t
+inode_read_direct (struct inode *inode, void *buffer_, off_t size,
+		off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
@@ -288,21 +326,16 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	return bytes_read;
 }
 
-/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
- * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+/* Writes like inode_write_at(), but straight to the disk,
+ * bypassing the page cache, and even if writes are denied. */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_write_direct (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
 	uint8_t *bounce = NULL;
 
 	bool grow = false;
-	if (inode->deny_write_cnt)
-		return 0;
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -402,6 +435,28 @@ inode_allow_write (struct inode *inode) {
 	inode->deny_write_cnt--;
 }
 
+/* Counts a new mapping of INODE, which stays open for as long as
+ * the mapping lives. */
+void
+inode_map (struct inode *inode) {
+	inode->map_cnt++;
+	ASSERT (inode->map_cnt <= inode->open_cnt);
+}
+
+/* Undoes inode_map(), before closing the inode. */
+void
+inode_unmap (struct inode *inode) {
+	ASSERT (inode->map_cnt > 0);
+	inode->map_cnt--;
+}
+
+/* Returns true if INODE is mapped by some process, so that its
+ * writers have to keep the mapped pages up to date. */
+bool
+inode_is_mapped (const struct inode *inode) {
+	return inode->map_cnt > 0;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
@@ -1,9 +1,18 @@
 /* page_cache.c: Implementation of Page Cache (Buffer Cache). */
 
 #include "vm/vm.h"
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/inode.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
 static bool page_cache_readahead (struct page *page, void *kva);
 static bool page_cache_writeback (struct page *page);
 static void page_cache_destroy (struct page *page);
+static void page_cache_kworkerd (void *aux);
+static void page_cache_readaheadd (void *aux);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations page_cache_op = {
@@ -15,36 +24,518 @@ static const struct page_operations page_cache_op = {
 
 tid_t page_cache_workerd;
 
+/* Pages of file data the cache holds. */
+#define PAGE_CACHE_PAGES 64
+
+/* How long dirty data stays in the cache before the worker writes
+ * it back. */
+#define WRITEBACK_TICKS TIMER_FREQ
+
+/* The cache is a fixed set of entries, each a struct page of type
+ * VM_PAGE_CACHE holding one page of some inode, found through an
+ * index keyed by (inode, offset) and reused in clock order.
+ *
+ * Every inode_read_at() and inode_write_at() goes through it, and
+ * so do file-backed pages, which read and write their file.  A
+ * mapped page still gets a frame of its own that the data is
+ * copied into, so a file that is both read and mapped is held
+ * twice; the cache buffers are not mapped into user space, since
+ * they come from the kernel pool and are reused in clock order,
+ * which a user mapping would have to hold up.  Coming from the
+ * kernel pool, they also mean that writing back an evicted
+ * mapping while frame_lock is held never has to wait for a user
+ * frame.  The two copies are kept in step on write(), which also
+ * updates the resident mapped pages (vm_file_write()); stores
+ * through a mapping reach the file, and so read(), only once the
+ * page is flushed, synced or evicted.
+ *
+ * cache_lock protects everything but the data.  That is copied
+ * with the entry pinned and the lock released, because the other
+ * side of the copy may be user memory that faults.  Disk I/O is
+ * done without the lock too, with the entry marked busy: nobody
+ * pins, reuses or writes back a busy entry, and lookups that find
+ * one wait for its I/O to finish, so file I/O on other pages goes
+ * on meanwhile. */
+static struct page cache[PAGE_CACHE_PAGES];
+static struct ohash cache_index;
+static size_t cache_hand;               /* Next entry the clock looks at. */
+static struct lock cache_lock;
+static struct condition cache_changed;  /* An entry was unpinned or
+                                           finished its I/O. */
+static struct semaphore dirty_sema;     /* Wakes the write-back worker. */
+static size_t dirty_cnt;                /* Dirty entries. */
+
+/* Background readahead requests, queued by page_cache_prefetch()
+ * and served by the readahead worker.  Protected by cache_lock. */
+#define PREFETCH_MAX 16
+struct prefetch {
+	struct inode *inode;        /* Reopened for the request. */
+	off_t offset;
+	off_t length;
+};
+static struct prefetch prefetch_queue[PREFETCH_MAX];
+static size_t prefetch_head;            /* Oldest request. */
+static size_t prefetch_cnt;             /* Requests queued. */
+static struct semaphore prefetch_sema;  /* Counts queued requests. */
+
+/* Statistics. */
+static long long hit_cnt;               /* Lookups that found the page. */
+static long long miss_cnt;              /* Lookups that read it in. */
+static long long writeback_cnt;         /* Pages written back. */
+static long long prefetch_page_cnt;     /* Pages read ahead in the background. */
+
+static hash_hash_func cache_hash;
+static hash_less_func cache_less;
+static struct page *cache_find (struct inode *, off_t offset);
+static struct page *cache_get (struct inode *, off_t offset, bool fill);
+static void cache_release (struct page *, bool dirty);
+
 /* The initializer of file vm */
 void
-pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
+page_cache_init (void) {
+	uint8_t *buf = palloc_get_multiple (0, PAGE_CACHE_PAGES);
+	size_t i;
+
+	if (buf == NULL)
+		PANIC ("page cache: out of memory");
+	lock_init (&cache_lock);
+	cond_init (&cache_changed);
+	sema_init (&dirty_sema, 0);
+	sema_init (&prefetch_sema, 0);
+	ohash_init (&cache_index, cache_hash, cache_less, NULL);
+	for (i = 0; i < PAGE_CACHE_PAGES; i++)
+		page_cache_initializer (&cache[i], VM_PAGE_CACHE, buf + i * PGSIZE);
+
+	page_cache_workerd = thread_create ("kworkerd", PRI_DEFAULT,
+			page_cache_kworkerd, NULL);
+	thread_create ("kreadahead", PRI_DEFAULT, page_cache_readaheadd, NULL);
 }
 
 /* Initialize the page cache */
 bool
-page_cache_initializer (struct page *page, enum vm_type type, void *kva) {
+page_cache_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva) {
+	struct page_cache *pc = &page->page_cache;
+
 	/* Set up the handler */
 	page->operations = &page_cache_op;
+	page->va = NULL;
+	page->frame = NULL;
 
+	pc->inode = NULL;
+	pc->offset = 0;
+	pc->kva = kva;
+	pc->pin_cnt = 0;
+	pc->busy = false;
+	pc->dirty = false;
+	pc->accessed = false;
+	return true;
 }
 
 /* Utilze the Swap in mechanism to implement readhead */
+// reads the page in; the tail past the end of the file reads as zeros
 static bool
 page_cache_readahead (struct page *page, void *kva) {
+	struct page_cache *pc = &page->page_cache;
+	off_t read = inode_read_direct (pc->inode, kva, PGSIZE, pc->offset);
+
+	memset (kva + read, 0, PGSIZE - read);
+	return true;
 }
 
 /* Utilze the Swap out mechanism to implement writeback */
+// writes the data out; see cache_writeback() for the bookkeeping
 static bool
 page_cache_writeback (struct page *page) {
+	struct page_cache *pc = &page->page_cache;
+	off_t length = inode_length (pc->inode) - pc->offset;
+
+	if (length > PGSIZE)
+		length = PGSIZE;
+	if (length > 0)
+		inode_write_direct (pc->inode, pc->kva, length, pc->offset);
+	return true;
 }
 
 /* Destory the page_cache. */
+// frees the entry, which must be clean, for another page
 static void
 page_cache_destroy (struct page *page) {
+	struct page_cache *pc = &page->page_cache;
+
+	ASSERT (!pc->dirty && !pc->busy && pc->pin_cnt == 0);
+	ohash_delete (&cache_index, &page->hash_elem);
+	pc->inode = NULL;
+}
+
+/* Writes PAGE, which is dirty and neither pinned nor busy, back to
+ * its file, marked busy and with cache_lock released meanwhile.
+ * Must be called with cache_lock held. */
+static void
+cache_writeback (struct page *page) {
+	struct page_cache *pc = &page->page_cache;
+
+	ASSERT (pc->dirty && !pc->busy && pc->pin_cnt == 0);
+	pc->busy = true;
+	pc->dirty = false;
+	dirty_cnt--;
+	lock_release (&cache_lock);
+	swap_out (page);
+	lock_acquire (&cache_lock);
+	pc->busy = false;
+	writeback_cnt++;
+	cond_broadcast (&cache_changed, &cache_lock);
 }
 
 /* Worker thread for page cache */
+// sleeps until something gets dirty, then gives writers a while to
+// finish before writing everything back
+static void
+page_cache_kworkerd (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&dirty_sema);
+		timer_sleep (WRITEBACK_TICKS);
+		page_cache_flush ();
+	}
+}
+
+/* Readahead worker: reads the pages of each queued request into
+ * the cache, at most half the cache per request so it does not
+ * push out its own pages. */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_readaheadd (void *aux UNUSED) {
+	for (;;) {
+		struct prefetch req;
+		off_t offset, end;
+		int cnt = 0;
+
+		sema_down (&prefetch_sema);
+		lock_acquire (&cache_lock);
+		req = prefetch_queue[prefetch_head];
+		prefetch_head = (prefetch_head + 1) % PREFETCH_MAX;
+		prefetch_cnt--;
+		lock_release (&cache_lock);
+
+		end = req.offset + req.length;
+		if (end > inode_length (req.inode))
+			end = inode_length (req.inode);
+		for (offset = req.offset - req.offset % PGSIZE;
+				offset < end && cnt < PAGE_CACHE_PAGES / 2;
+				offset += PGSIZE, cnt++) {
+			lock_acquire (&cache_lock);
+			if (cache_find (req.inode, offset) == NULL) {
+				cache_release (cache_get (req.inode, offset, true), false);
+				prefetch_page_cnt++;
+			}
+			lock_release (&cache_lock);
+		}
+		inode_close (req.inode);
+	}
+}
+
+/* Hash and comparison functions for the index. */
+static uint64_t
+cache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct page_cache *pc = &hash_entry (e, struct page, hash_elem)->page_cache;
+	return (uint64_t) pc->inode ^ pc->offset;
+}
+
+static bool
+cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct page_cache *a = &hash_entry (a_, struct page, hash_elem)->page_cache;
+	const struct page_cache *b = &hash_entry (b_, struct page, hash_elem)->page_cache;
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	return a->offset < b->offset;
+}
+
+/* Returns the entry holding the page at OFFSET in INODE, or a null
+ * pointer if it is not cached.  Must be called with cache_lock
+ * held. */
+static struct page *
+cache_find (struct inode *inode, off_t offset) {
+	struct page key;
+	struct hash_elem *e;
+
+	key.page_cache.inode = inode;
+	key.page_cache.offset = offset;
+	e = ohash_find (&cache_index, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Picks an entry to reuse with the clock (second chance)
+ * algorithm and frees it.  A dirty entry the hand would take is
+ * written back first, which releases cache_lock for a while, and
+ * the hand moves on; the entry is taken on a later lap if it is
+ * still unused.  Waits while every entry is pinned or busy.  Must
+ * be called with cache_lock held. */
+static struct page *
+cache_evict (void) {
+	for (;;) {
+		/* Two laps clear every accessed bit. */
+		size_t budget = 2 * PAGE_CACHE_PAGES;
+		bool wrote = false;
+
+		while (budget-- > 0) {
+			struct page *page = &cache[cache_hand];
+			struct page_cache *pc = &page->page_cache;
+
+			cache_hand = (cache_hand + 1) % PAGE_CACHE_PAGES;
+			if (pc->pin_cnt > 0 || pc->busy)
+				continue;
+			if (pc->inode == NULL)
+				return page;
+			if (pc->accessed) {
+				pc->accessed = false;
+				continue;
+			}
+			if (pc->dirty) {
+				cache_writeback (page);
+				wrote = true;
+				continue;
+			}
+			destroy (page);
+			return page;
+		}
+		if (!wrote)
+			cond_wait (&cache_changed, &cache_lock);
+	}
+}
+
+/* Returns the entry holding the page at OFFSET in INODE, pinned.
+ * If it is not cached it is read in, unless FILL is false because
+ * the caller is about to overwrite all of it.  Must be called with
+ * cache_lock held, which is released while waiting for or doing
+ * I/O. */
+static struct page *
+cache_get (struct inode *inode, off_t offset, bool fill) {
+	struct page *page;
+	struct page_cache *pc;
+
+	for (;;) {
+		page = cache_find (inode, offset);
+		if (page != NULL) {
+			pc = &page->page_cache;
+			if (pc->busy) {
+				cond_wait (&cache_changed, &cache_lock);
+				continue;
+			}
+			pc->pin_cnt++;
+			pc->accessed = true;
+			hit_cnt++;
+			return page;
+		}
+
+		/* Someone else may read the page in while cache_evict()
+		 * writes an entry back; then the entry it returns just stays
+		 * free. */
+		page = cache_evict ();
+		if (cache_find (inode, offset) == NULL)
+			break;
+	}
+
+	pc = &page->page_cache;
+	pc->inode = inode;
+	pc->offset = offset;
+	pc->pin_cnt++;
+	pc->accessed = true;
+	ohash_insert (&cache_index, &page->hash_elem);
+	miss_cnt++;
+	if (fill) {
+		pc->busy = true;
+		lock_release (&cache_lock);
+		swap_in (page, pc->kva);
+		lock_acquire (&cache_lock);
+		pc->busy = false;
+		cond_broadcast (&cache_changed, &cache_lock);
+	}
+	return page;
+}
+
+/* Unpins PAGE, marking it dirty if DIRTY.  Must be called with
+ * cache_lock held. */
+static void
+cache_release (struct page *page, bool dirty) {
+	struct page_cache *pc = &page->page_cache;
+
+	if (dirty && !pc->dirty) {
+		pc->dirty = true;
+		if (dirty_cnt++ == 0)
+			sema_up (&dirty_sema);
+	}
+	if (--pc->pin_cnt == 0)
+		cond_broadcast (&cache_changed, &cache_lock);
+}
+
+/* Unpins PAGE, marking it dirty if DIRTY. */
+static void
+cache_put (struct page *page, bool dirty) {
+	lock_acquire (&cache_lock);
+	cache_release (page, dirty);
+	lock_release (&cache_lock);
+}
+
+/* Reads SIZE bytes from INODE into BUFFER, starting at position
+ * OFFSET, through the cache.  Returns the number of bytes actually
+ * read, which may be less than SIZE if end of file is reached. */
+off_t
+page_cache_read (struct inode *inode, void *buffer_, off_t size,
+		off_t offset) {
+	uint8_t *buffer = buffer_;
+	off_t bytes_read = 0;
+
+	while (size > 0) {
+		/* Bytes left in inode, bytes left in page, lesser of the two. */
+		off_t page_ofs = offset % PGSIZE;
+		off_t inode_left = inode_length (inode) - offset;
+		off_t page_left = PGSIZE - page_ofs;
+		off_t min_left = inode_left < page_left ? inode_left : page_left;
+
+		/* Number of bytes to actually copy out of this page. */
+		off_t chunk_size = size < min_left ? size : min_left;
+		struct page *page;
+
+		if (chunk_size <= 0)
+			break;
+
+		lock_acquire (&cache_lock);
+		page = cache_get (inode, offset - page_ofs, true);
+		lock_release (&cache_lock);
+		memcpy (buffer + bytes_read, page->page_cache.kva + page_ofs,
+				chunk_size);
+		cache_put (page, false);
+
+		/* Advance. */
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_read += chunk_size;
+	}
+	return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+ * through the cache, which writes them back later.  Returns the
+ * number of bytes actually written, which may be less than SIZE
+ * if end of file is reached. */
+off_t
+page_cache_write (struct inode *inode, const void *buffer_, off_t size,
+		off_t offset) {
+	const uint8_t *buffer = buffer_;
+	off_t bytes_written = 0;
+
+	while (size > 0) {
+		/* Bytes left in inode, bytes left in page, lesser of the two. */
+		off_t page_ofs = offset % PGSIZE;
+		off_t inode_left = inode_length (inode) - offset;
+		off_t page_left = PGSIZE - page_ofs;
+		off_t min_left = inode_left < page_left ? inode_left : page_left;
+
+		/* Number of bytes to actually write into this page. */
+		off_t chunk_size = size < min_left ? size : min_left;
+		struct page *page;
+
+		if (chunk_size <= 0)
+			break;
+
+		/* A page that is overwritten whole need not be read first. */
+		lock_acquire (&cache_lock);
+		page = cache_get (inode, offset - page_ofs, chunk_size < PGSIZE);
+		lock_release (&cache_lock);
+		memcpy (page->page_cache.kva + page_ofs, buffer + bytes_written,
+				chunk_size);
+		cache_put (page, true);
+
+		/* Advance. */
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_written += chunk_size;
+	}
+	return bytes_written;
+}
+
+/* Frees every cached page of INODE, which is being closed for the
+ * last time, writing the dirty ones back first if WRITE_BACK. */
+void
+page_cache_drop (struct inode *inode, bool write_back) {
+	off_t length = inode_length (inode);
+	off_t offset;
+
+	lock_acquire (&cache_lock);
+	for (offset = 0; offset < length; offset += PGSIZE) {
+		struct page *page;
+
+		/* Looked up again after every wait, since the entry may
+		 * have been reused meanwhile. */
+		while ((page = cache_find (inode, offset)) != NULL) {
+			struct page_cache *pc = &page->page_cache;
+
+			if (pc->busy)
+				cond_wait (&cache_changed, &cache_lock);
+			else if (pc->dirty && write_back)
+				cache_writeback (page);
+			else {
+				if (pc->dirty) {
+					pc->dirty = false;
+					dirty_cnt--;
+				}
+				destroy (page);
+			}
+		}
+	}
+	lock_release (&cache_lock);
+}
+
+/* Writes back every dirty page that is not being copied.  The
+ * worker comes back later for any that were. */
+void
+page_cache_flush (void) {
+	size_t i;
+
+	lock_acquire (&cache_lock);
+	for (i = 0; i < PAGE_CACHE_PAGES; i++) {
+		struct page_cache *pc = &cache[i].page_cache;
+
+		if (pc->inode != NULL && pc->dirty && pc->pin_cnt == 0 && !pc->busy)
+			cache_writeback (&cache[i]);
+	}
+	if (dirty_cnt > 0)
+		sema_up (&dirty_sema);
+	lock_release (&cache_lock);
+}
+
+/* Queues the LENGTH bytes of INODE from OFFSET to be read into the
+ * cache in the background.  A request that continues the last one
+ * queued is merged into it; one that finds the queue full is
+ * dropped, since it is only a hint. */
+void
+page_cache_prefetch (struct inode *inode, off_t offset, off_t length) {
+	lock_acquire (&cache_lock);
+	if (prefetch_cnt > 0) {
+		struct prefetch *last = &prefetch_queue[(prefetch_head + prefetch_cnt - 1)
+			% PREFETCH_MAX];
+		if (last->inode == inode && last->offset + last->length == offset) {
+			last->length += length;
+			lock_release (&cache_lock);
+			return;
+		}
+	}
+	if (prefetch_cnt < PREFETCH_MAX) {
+		struct prefetch *req = &prefetch_queue[(prefetch_head + prefetch_cnt++)
+			% PREFETCH_MAX];
+		req->inode = inode_reopen (inode);
+		req->offset = offset;
+		req->length = length;
+		sema_up (&prefetch_sema);
+	}
+	lock_release (&cache_lock);
+}
+
+/* Prints page cache statistics. */
+void
+page_cache_print_stats (void) {
+	printf ("Page cache: %lld hits, %lld misses, %lld pages written back, "
+			"%lld read ahead\n",
+			hit_cnt, miss_cnt, writeback_cnt, prefetch_page_cnt);
 }
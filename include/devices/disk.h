@@ -2,6 +2,7 @@
 #define DEVICES_DISK_H
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /* Size of a disk sector in bytes. */
@@ -23,5 +24,13 @@ disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
 
+/* Most sectors one disk_read_multiple() or disk_write_multiple()
+ * can transfer, the limit of the ATA sector count register. */
+#define DISK_MULTIPLE_MAX 256
+
+void disk_read_multiple (struct disk *, disk_sector_t, void *, size_t cnt);
+void disk_write_multiple (struct disk *, disk_sector_t, const void *,
+		size_t cnt);
+
 void 	register_disk_inspect_intr ();
 #endif /* devices/disk.h */
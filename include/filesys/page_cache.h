@@ -1,12 +1,30 @@
 #ifndef FILESYS_PAGE_CACHE_H
 #define FILESYS_PAGE_CACHE_H
-#include "vm/vm.h"
+#include <stdbool.h>
+#include "filesys/off_t.h"
 
 struct page;
+struct inode;
 enum vm_type;
 
-struct page_cache {};
+/* A page of file data in the page cache. */
+struct page_cache {
+	struct inode *inode;        /* File the page belongs to, or null if free. */
+	off_t offset;               /* Page-aligned offset within the file. */
+	void *kva;                  /* Buffer holding the data. */
+	int pin_cnt;                /* Copies in progress; not to be reused. */
+	bool busy;                  /* Being read in or written back. */
+	bool dirty;                 /* Modified since last written back. */
+	bool accessed;              /* Used since the clock hand last passed. */
+};
 
 void page_cache_init (void);
 bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+off_t page_cache_read (struct inode *, void *, off_t size, off_t offset);
+off_t page_cache_write (struct inode *, const void *, off_t size,
+		off_t offset);
+void page_cache_drop (struct inode *, bool write_back);
+void page_cache_flush (void);
+void page_cache_prefetch (struct inode *, off_t offset, off_t length);
+void page_cache_print_stats (void);
 #endif
@@ -0,0 +1,30 @@
+#ifndef __LIB_FAULT_STATS_H
+#define __LIB_FAULT_STATS_H
+
+#include <stdint.h>
+
+/* Kinds of page fault the kernel tells apart. */
+enum fault_kind {
+	FAULT_MINOR,                /* Served without I/O: zero page, shared
+	                               text, or a fresh anonymous page. */
+	FAULT_MAJOR,                /* Read from a file or from swap. */
+	FAULT_COW,                  /* Write to a copy-on-write page. */
+	FAULT_STACK,                /* Stack growth. */
+	FAULT_INVALID,              /* Spurious or invalid; not handled. */
+	FAULT_KIND_CNT
+};
+
+/* Service times are histogrammed by powers of 2: bucket B counts
+ * faults that took fewer than 2^(B + FAULT_HIST_SHIFT + 1) cycles,
+ * and the last bucket everything slower. */
+#define FAULT_HIST_BUCKETS 16
+#define FAULT_HIST_SHIFT 8
+
+/* Page fault statistics, of one process or of the whole system. */
+struct fault_stats {
+	uint64_t count[FAULT_KIND_CNT];     /* Faults of each kind. */
+	uint64_t cycles[FAULT_KIND_CNT];    /* TSC cycles spent serving them. */
+	uint32_t hist[FAULT_KIND_CNT][FAULT_HIST_BUCKETS];
+};
+
+#endif /* lib/fault-stats.h */
@@ -0,0 +1,35 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* Fast LZ77 block compression in the style of LZ4.
+ *
+ * Meant for compressing single pages in memory, where speed
+ * matters far more than ratio: the compressor finds matches
+ * through a small hash table of 4-byte sequences and never
+ * searches further, and the decompressor is a loop of copies.
+ *
+ * A block is a series of sequences.  Each starts with a token
+ * byte whose high nibble is the number of literal bytes and low
+ * nibble the match length minus LZ_MIN_MATCH; a nibble of 15 is
+ * extended by following bytes, each added in, until one is less
+ * than 255.  The literals come next, then the 2-byte little-endian
+ * distance back to the match and the match length extension.  The
+ * last sequence has only literals.  Blocks are at most 64 kB. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Shortest match worth encoding. */
+#define LZ_MIN_MATCH 4
+
+/* Bytes of scratch memory lz_compress() needs. */
+#define LZ_HASH_BITS 12
+#define LZ_WORK_SIZE (sizeof (uint16_t) << LZ_HASH_BITS)
+
+size_t lz_compress (const void *src, size_t src_len,
+		void *dst, size_t dst_cap, void *work);
+bool lz_decompress (const void *src, size_t src_len,
+		void *dst, size_t dst_len);
+
+#endif /* lib/kernel/lz.h */
@@ -0,0 +1,86 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressing hash table.
+ *
+ * A drop-in alternative to the chained table in hash.h for hot
+ * lookup paths such as the supplemental page table.  Elements
+ * still embed a struct hash_elem and use the same hash, less and
+ * action functions, so a structure can move between the two
+ * kinds of table without changes.
+ *
+ * Instead of an array of linked lists, the table is a flat array
+ * of (hash, element) slots probed linearly with Robin Hood
+ * ordering: an entry that is far from its home slot displaces
+ * one that is closer to its own, which keeps probe sequences
+ * short and lets an unsuccessful search stop early.  The cached
+ * hash means the comparison function is only called for entries
+ * whose full 64-bit hash already matches, and a lookup touches
+ * one or two cache lines instead of chasing list pointers.
+ *
+ * Growing the table is incremental.  When the load factor passes
+ * 7/8 a table of twice the size is allocated and the old one is
+ * drained a few slots at a time by later insertions and
+ * deletions, so no single operation pays for moving every
+ * element.  While a drain is in progress lookups consult both
+ * tables.  The slot array never shrinks; only ohash_destroy()
+ * releases it. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hash.h"
+
+/* One slot of an open-addressing table. */
+struct ohash_slot {
+	uint64_t hash;              /* Cached hash of ELEM. */
+	struct hash_elem *elem;     /* Element, or a null pointer if empty. */
+};
+
+/* A single power-of-2 sized slot array. */
+struct ohash_table {
+	size_t slot_cnt;            /* Number of slots, a power of 2. */
+	size_t elem_cnt;            /* Number of occupied slots. */
+	struct ohash_slot *slots;   /* Array of `slot_cnt' slots. */
+};
+
+/* Open-addressing hash table. */
+struct ohash {
+	struct ohash_table cur;     /* Table new elements go into. */
+	struct ohash_table old;     /* Table being drained, or empty. */
+	size_t drain_idx;           /* Next slot of `old' to move. */
+	hash_hash_func *hash;       /* Hash function. */
+	hash_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `hash' and `less'. */
+};
+
+/* An open-addressing hash table iterator. */
+struct ohash_iterator {
+	struct ohash *hash;         /* The hash table. */
+	struct ohash_table *table;  /* Table being walked. */
+	size_t idx;                 /* Current slot in `table'. */
+	struct hash_elem *elem;     /* Current hash element. */
+};
+
+/* Basic life cycle. */
+bool ohash_init (struct ohash *, hash_hash_func *, hash_less_func *, void *aux);
+void ohash_clear (struct ohash *, hash_action_func *);
+void ohash_destroy (struct ohash *, hash_action_func *);
+
+/* Search, insertion, deletion. */
+struct hash_elem *ohash_insert (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_replace (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_find (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_delete (struct ohash *, struct hash_elem *);
+
+/* Iteration. */
+void ohash_apply (struct ohash *, hash_action_func *);
+void ohash_first (struct ohash_iterator *, struct ohash *);
+struct hash_elem *ohash_next (struct ohash_iterator *);
+struct hash_elem *ohash_cur (struct ohash_iterator *);
+
+/* Information. */
+size_t ohash_size (struct ohash *);
+bool ohash_empty (struct ohash *);
+
+#endif /* lib/kernel/ohash.h */
@@ -0,0 +1,14 @@
+#ifndef __LIB_MADVISE_H
+#define __LIB_MADVISE_H
+
+/* Advice for madvise().  The first three describe how a region
+ * will be accessed and stay with its pages; the last two act on
+ * the pages once. */
+#define MADV_NORMAL 0           /* No particular order. */
+#define MADV_RANDOM 1           /* Random order: no fault-around. */
+#define MADV_SEQUENTIAL 2       /* Sequential: read far ahead and
+                                   reclaim early behind. */
+#define MADV_WILLNEED 3         /* Will be used soon: prefetch. */
+#define MADV_DONTNEED 4         /* Not needed: drop the frames. */
+
+#endif /* lib/madvise.h */
@@ -0,0 +1,17 @@
+#ifndef __LIB_SPAWN_H
+#define __LIB_SPAWN_H
+
+/* One entry of spawn()'s list of descriptors to inherit: the child
+ * gets a copy of the parent's PARENT_FD as its CHILD_FD.  The list
+ * ends with an entry whose PARENT_FD is SPAWN_FD_END.  Fds 0 and 1
+ * are the console unless an entry replaces them; no other fd of
+ * the parent is inherited. */
+struct spawn_fd {
+	int parent_fd;
+	int child_fd;
+};
+
+#define SPAWN_FD_END (-1)       /* Ends the list. */
+#define SPAWN_FD_MAX 16         /* Most entries in one list. */
+
+#endif /* lib/spawn.h */
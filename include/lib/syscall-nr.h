@@ -36,6 +36,18 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_FAULTSTAT,              /* Obtain page fault statistics. */
+	SYS_MADVISE,                /* Advise on the use of a memory range. */
+	SYS_MSYNC,                  /* Write a mapped range back to its file. */
+	SYS_WORKINGSET,             /* Estimate the working set size. */
+
+	SYS_SPAWN,                  /* Start a program in a new process. */
+
+	SYS_MLOCK,                  /* Lock a memory range in memory. */
+	SYS_MUNLOCK,                /* Unlock a memory range. */
+	SYS_MLOCKALL,               /* Lock the whole address space. */
 };
 
 #endif /* lib/syscall-nr.h */
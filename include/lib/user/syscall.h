@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <fault-stats.h>
+#include <madvise.h>
+#include <spawn.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -37,10 +40,18 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+pid_t spawn (const char *cmdline, const struct spawn_fd *fds);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+void faultstat (struct fault_stats *stats, bool all);
+int madvise (void *addr, size_t length, int advice);
+int msync (void *addr, size_t length);
+size_t workingset (void);
+int mlock (void *addr, size_t length);
+int munlock (void *addr, size_t length);
+int mlockall (void);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
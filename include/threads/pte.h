@@ -41,5 +41,13 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=2 MB large page (PDEs only). */
+#define PTE_G 0x100                      /* 1=global, kept across CR3 loads. */
+
+/* A page-directory entry with PTE_PS set maps a 2 MB large page
+   directly instead of pointing to a page table.  In a 4 kB PTE the
+   same bit is PAT, which we never set. */
+#define LPGSIZE (1UL << PDXSHIFT)        /* Bytes in a large page. */
+#define LPGMASK (LPGSIZE - 1)            /* Large page offset bits (0:21). */
 
 #endif /* threads/pte.h */
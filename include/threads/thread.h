@@ -139,6 +139,9 @@ struct thread
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
 	void *stack_bottom;
+	struct fault_stats *fault_stats; // page faults of this process (vm_try_handle_fault)
+	struct startup_trace *startup;	 // startup faults being recorded (vm_startup_begin)
+	size_t mlock_cnt;				 // pages mlocked by this process (vm_mlock)
 	
 #endif
 
@@ -197,7 +200,7 @@ void thread_update_recentcpu(struct thread *t);
 void update_load_avg();
 void total_update_priority();
 void thread_update_priority(struct thread *t);
-int load_avg;
+extern int load_avg;
 int thread_get_nice(void);
 void thread_set_nice(int);
 int thread_get_recent_cpu(void);
@@ -6,7 +6,12 @@
 #define PF_W 0x2    /* 0: read, 1: write. */
 #define PF_U 0x4    /* 0: kernel, 1: user process. */
 
+#include <stdbool.h>
+#include <stddef.h>
+
 void exception_init (void);
 void exception_print_stats (void);
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
 
 #endif /* userprog/exception.h */
@@ -1,11 +1,13 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <spawn.h>
 #include "threads/thread.h"
 
 tid_t process_create_initd(const char *file_name);
 tid_t process_fork(const char *name, struct intr_frame *if_);
 int process_exec(void *f_name);
+tid_t process_spawn(char *cmdline, const struct spawn_fd *fds, size_t fd_cnt);
 int process_wait(tid_t);
 void process_exit(void);
 void process_activate(struct thread *next);
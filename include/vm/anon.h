@@ -5,9 +5,16 @@ struct page;
 enum vm_type;
 
 struct anon_page {
+	size_t swap_slot;           /* Swap slot, or BITMAP_ERROR if none. */
 };
 
+/* Pool pages the compressed swap cache may use (-zswap=PAGES). */
+extern size_t zswap_max_pages;
+
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void anon_discard (struct page *page);
+void anon_swap_copy (struct page *page, void *kva);
+void anon_print_stats (void);
 
 #endif
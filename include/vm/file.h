@@ -4,17 +4,35 @@
 #include "vm/vm.h"
 
 struct page;
+struct supplemental_page_table;
 enum vm_type;
 
 struct file_page {
 	struct file *file;
 	size_t length;
 	off_t offset;
+	struct inode *inode;        /* Executable text (VM_TEXT) only: the
+	                               program's inode, read instead of FILE. */
+};
+
+/* One mmap() of a process, on its SPT's list of mappings.  The pages
+ * of the mapping share FILE, which the mapping reopened and closes
+ * once it goes away. */
+struct mmap_region {
+	void *addr;                 /* First page of the mapping. */
+	struct file *file;          /* Reopened file the pages read. */
+	struct list_elem elem;      /* Element in the SPT's mmaps. */
 };
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool page_is_text (struct page *page);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+void mmap_close_all (struct supplemental_page_table *spt);
+bool mmap_copy_all (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src);
+struct file *mmap_copy_file (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src, struct file *file);
 #endif
@@ -0,0 +1,58 @@
+#ifndef VM_RMAP_H
+#define VM_RMAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct page;
+
+/* Reverse map: the pages mapping a frame, each of which gives a
+ * (pml4, va) pair that maps it.  Most frames have a single mapper
+ * and a few more are shared by a handful of processes after fork
+ * or through the text cache, so the first RMAP_INLINE pages are
+ * kept in the rmap itself and only the rest spill into a chain of
+ * allocated chunks.  Entries are in no particular order.  Every
+ * operation takes time proportional to the number of mappers at
+ * most.  Protected by frame_lock, like the frame. */
+#define RMAP_INLINE 2
+#define RMAP_CHUNK 7
+
+struct rmap_chunk {
+	struct page *pages[RMAP_CHUNK];
+	struct rmap_chunk *next;
+};
+
+struct rmap {
+	size_t cnt;                         /* Pages mapping the frame. */
+	struct page *pages[RMAP_INLINE];    /* The first ones. */
+	struct rmap_chunk *spill;           /* The rest, in chunks. */
+};
+
+/* Iterator over an rmap:
+
+   struct rmap_iter i;
+   struct page *page;
+
+   for (page = rmap_first (rmap, &i); page != NULL; page = rmap_next (&i))
+     ...do something with page...
+
+   Changing the rmap invalidates all iterators. */
+struct rmap_iter {
+	const struct rmap *rmap;
+	size_t idx;
+	struct rmap_chunk *chunk;
+};
+
+void rmap_init (struct rmap *);
+bool rmap_add (struct rmap *, struct page *);
+void rmap_remove (struct rmap *, struct page *);
+struct page *rmap_pop (struct rmap *);
+struct page *rmap_first (const struct rmap *, struct rmap_iter *);
+struct page *rmap_next (struct rmap_iter *);
+
+/* Returns the number of pages mapping the frame. */
+static inline size_t
+rmap_count (const struct rmap *rmap) {
+	return rmap->cnt;
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef VM_SLAB_H
+#define VM_SLAB_H
+#include <stddef.h>
+#include <list.h>
+#include "threads/synch.h"
+
+/* Slab pool: a cache of fixed-size objects carved out of whole
+ * pages, for metadata that is allocated and freed on every fault,
+ * fork and exit.  Each page ("slab") starts with a small header
+ * and holds as many objects as fit after it, so an object costs
+ * exactly its size instead of malloc()'s power-of-two block, and
+ * allocation and freeing are a pop and a push on the slab's free
+ * list.  A slab whose objects are all free goes back to palloc,
+ * except for the last one, which is kept to absorb alloc/free
+ * churn. */
+struct slab_pool {
+	const char *name;           /* For statistics. */
+	size_t size;                /* Object size, pointer-aligned. */
+	size_t per_slab;            /* Objects per slab. */
+	struct list partial;        /* Slabs with at least one free object. */
+	struct lock lock;
+
+	size_t slab_cnt;            /* Slabs held. */
+	size_t used_cnt;            /* Objects handed out. */
+};
+
+void slab_pool_init (struct slab_pool *, const char *name, size_t size);
+void *slab_alloc (struct slab_pool *);
+void slab_free (struct slab_pool *, void *);
+void slab_print_stats (struct slab_pool *);
+
+#endif
@@ -1,19 +1,33 @@
 #ifndef VM_UNINIT_H
 #define VM_UNINIT_H
+#include <stdint.h>
+#include "filesys/off_t.h"
 #include "vm/vm.h"
 
 struct page;
+struct file;
 enum vm_type;
 
 typedef bool vm_initializer (struct page *, void *aux);
 
+/* Where a lazily loaded page's contents come from: PAGE_READ_BYTES
+ * bytes of FILE at OFFSET, followed by PAGE_ZERO_BYTES zeros. */
+struct lazy_load_info {
+	struct file *file;
+	off_t offset;
+	uint16_t page_read_bytes;
+	uint16_t page_zero_bytes;
+};
+
 /* Uninitlialized page. The type for implementing the
  * "Lazy loading". */
 struct uninit_page {
 	/* Initiate the contets of the page */
 	vm_initializer *init;
 	enum vm_type type;
-	void *aux;
+	/* The loader's argument, kept in the page rather than allocated
+	 * separately; INIT gets a pointer to a copy of it. */
+	struct lazy_load_info lazy;
 	/* Initiate the struct page and maps the pa to the va */
 	bool (*page_initializer) (struct page *, enum vm_type, void *kva);
 };
@@ -21,4 +35,5 @@ struct uninit_page {
 void uninit_new (struct page *page, void *va, vm_initializer *init,
 		enum vm_type type, void *aux,
 		bool (*initializer)(struct page *, enum vm_type, void *kva));
+bool uninit_preload (struct page *page, void *kva);
 #endif
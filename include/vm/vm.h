@@ -4,6 +4,9 @@
 #include "threads/palloc.h"
 
 #include <hash.h>
+#include <ohash.h>
+#include <fault-stats.h>
+#include <madvise.h>
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
 
@@ -29,17 +32,20 @@ enum vm_type {
 };
 
 #include "vm/uninit.h"
+#include "vm/rmap.h"
 #include "vm/anon.h"
 #include "vm/file.h"
-#ifdef EFILESYS
 #include "filesys/page_cache.h"
-#endif
 
 struct page_operations;
 struct thread;
 
 #define VM_TYPE(type) ((type) & 7)
 
+/* Marks a read-only page of an executable's text, which the text
+ * cache shares between every process running the same program. */
+#define VM_TEXT VM_MARKER_1
+
 /* The representation of "page".
  * This is kind of "parent class", which has four "child class"es, which are
  * uninit_page, file_page, anon_page, and page cache (project4).
@@ -54,7 +60,12 @@ struct page {
 	struct hash_elem hash_elem; /* Hash table element for SPT */
 	// 29Oct21 - Writable 
 	bool writable; // 'vm_try_handler' needs to find out if the page is writable or read-only
+	uint8_t advice;             /* MADV_NORMAL, _RANDOM or _SEQUENTIAL. */
+	bool mlocked;               /* Locked in memory by mlock(). */
+	bool dead;                  /* Its process exited; waiting for the
+	                               reaper. */
 	int page_cnt;
+	uint64_t *pml4;             /* Page table the page is mapped in. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -62,16 +73,30 @@ struct page {
 		struct uninit_page uninit;
 		struct anon_page anon;
 		struct file_page file;
-#ifdef EFILESYS
 		struct page_cache page_cache;
-#endif
 	};
 };
 
-/* The representation of "frame" */
+/* The representation of "frame".  There is one for every page of
+ * the user pool, in an array indexed by its frame number within the
+ * pool (see frame_of()), so they are never allocated or freed. */
 struct frame {
 	void *kva;
-	struct page *page;
+	struct rmap rmap;           /* Pages mapping it; more than one if
+	                               shared copy-on-write after fork or
+	                               through the text cache. */
+	bool pinned;                /* Not to be evicted, e.g. while loading. */
+	bool evicting;              /* Being saved by vm_evict_frame(). */
+	uint8_t age;                /* Sampling periods since last used. */
+	uint64_t checksum;          /* Contents at the last merge scan. */
+	struct list_elem elem;      /* Element in the frame table. */
+
+	/* Text cache key, if the frame holds executable text that other
+	 * processes may map; INODE is a null pointer otherwise. */
+	struct inode *inode;
+	off_t offset;
+	size_t length;
+	struct hash_elem cache_elem;    /* Element in the text cache. */
 };
 
 /* The function table for page operations.
@@ -94,8 +119,9 @@ struct page_operations {
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table {
-    struct hash spt_hash;
+    struct ohash spt_hash;      /* Open addressing: spt_find_page() is on every fault. */
 	// 22Oct21 Design - key : page->va, value : struct page
+	struct list mmaps;          /* mmap_regions, one per live mapping. */
 };
 
 #include "threads/thread.h"
@@ -103,11 +129,21 @@ void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
 		struct supplemental_page_table *src);
 void supplemental_page_table_kill (struct supplemental_page_table *spt);
+void vm_reap (struct supplemental_page_table *spt, uint64_t *pml4);
 struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
+/* Pages populated per fault on a file-backed region (-fa=PAGES). */
+extern size_t fault_around_pages;
+/* Pages all processes together may mlock() (-mlock=PAGES). */
+extern size_t mlock_max_pages;
+/* Frames the merging thread checksums per period (-ksm=PAGES). */
+extern size_t merge_scan_pages;
+/* Print each process's page faults when it exits (-fstats). */
+extern bool fault_stats_print;
+
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
@@ -117,17 +153,24 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
+void vm_free_frame (struct page *page);
 bool vm_claim_page (void *va);
+void vm_print_stats (void);
+void vm_fault_stats (struct fault_stats *stats, bool all);
+bool vm_fault_stats_init (void);
+void vm_fault_stats_exit (void);
+int vm_madvise (void *addr, size_t length, int advice);
+int vm_msync (void *addr, size_t length);
+off_t vm_file_write (struct file *file, const void *buf, off_t size);
+size_t vm_working_set (void);
+void vm_startup_begin (struct file *exe);
+void vm_startup_end (void);
+int vm_mlock (void *addr, size_t length);
+int vm_munlock (void *addr, size_t length);
+int vm_mlockall (void);
+void *vm_mlocked_kva (const void *uaddr, bool write);
 enum vm_type page_get_type (struct page *page);
 
-// Project 3 - Copy SPT
-struct lazy_load_info{
-	struct file *file;
-	size_t page_read_bytes;
-	size_t page_zero_bytes;
-	off_t offset;
-};
-
 void remove_page(struct page *page);
 
 #endif  /* VM_VM_H */
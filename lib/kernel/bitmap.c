@@ -63,6 +63,57 @@ last_mask (const struct bitmap *b) {
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns a mask with bits START (inclusive) through END
+   (exclusive) of an element turned on.
+   0 <= START < END <= ELEM_BITS. */
+static inline elem_type
+range_mask (size_t start, size_t end) {
+	elem_type high = end < ELEM_BITS ? ((elem_type) 1 << end) - 1 : (elem_type) -1;
+	return high & ~(((elem_type) 1 << start) - 1);
+}
+
+/* Returns the number of bits set in X.  This is the classic
+   SWAR population count; __builtin_popcountl() would turn into a
+   libgcc call, since the kernel is not built with -mpopcnt. */
+static inline size_t
+popcount (elem_type x) {
+	x = x - ((x >> 1) & 0x5555555555555555UL);
+	x = (x & 0x3333333333333333UL) + ((x >> 2) & 0x3333333333333333UL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (x * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns element IDX of B with the bits that are set to VALUE
+   turned on. */
+static inline elem_type
+elem_matching (const struct bitmap *b, size_t idx, bool value) {
+	return value ? b->bits[idx] : ~b->bits[idx];
+}
+
+/* Returns the index of the first bit at or after START in B that
+   is set to VALUE, or B's bit count if there is none.  Skips
+   whole elements at a time. */
+static size_t
+find_next (const struct bitmap *b, size_t start, bool value) {
+	size_t idx = elem_idx (start);
+	size_t last = elem_cnt (b->bit_cnt);
+	elem_type word;
+
+	if (start >= b->bit_cnt)
+		return b->bit_cnt;
+
+	word = elem_matching (b, idx, value) & ~(elem_type) 0 << (start % ELEM_BITS);
+	while (word == 0) {
+		if (++idx >= last)
+			return b->bit_cnt;
+		word = elem_matching (b, idx, value);
+	}
+
+	/* Unused bits past the end of the last element may match. */
+	start = idx * ELEM_BITS + __builtin_ctzl (word);
+	return start < b->bit_cnt ? start : b->bit_cnt;
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -194,33 +245,51 @@ bitmap_set_all (struct bitmap *b, bool value) {
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Works on a whole element at a time; each element is updated
+   atomically. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
+	size_t end = start + cnt;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	while (start < end) {
+		size_t ofs = start % ELEM_BITS;
+		size_t n = end - start < ELEM_BITS - ofs ? end - start : ELEM_BITS - ofs;
+		elem_type *elem = &b->bits[elem_idx (start)];
+		elem_type mask = range_mask (ofs, ofs + n);
+
+		/* Same as the OR/AND in bitmap_mark() and bitmap_reset(). */
+		if (value)
+			asm ("lock orq %1, %0" : "=m" (*elem) : "r" (mask) : "cc");
+		else
+			asm ("lock andq %1, %0" : "=m" (*elem) : "r" (~mask) : "cc");
+		start += n;
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i, value_cnt;
+	size_t end = start + cnt;
+	size_t value_cnt = 0;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
+	while (start < end) {
+		size_t ofs = start % ELEM_BITS;
+		size_t n = end - start < ELEM_BITS - ofs ? end - start : ELEM_BITS - ofs;
+
+		value_cnt += popcount (elem_matching (b, elem_idx (start), value)
+				& range_mask (ofs, ofs + n));
+		start += n;
+	}
 	return value_cnt;
 }
 
@@ -228,15 +297,20 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
+	size_t end = start + cnt;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
+	while (start < end) {
+		size_t ofs = start % ELEM_BITS;
+		size_t n = end - start < ELEM_BITS - ofs ? end - start : ELEM_BITS - ofs;
+
+		if (elem_matching (b, elem_idx (start), value) & range_mask (ofs, ofs + n))
 			return true;
+		start += n;
+	}
 	return false;
 }
 
@@ -266,7 +340,9 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+   Jumps from run to run: a run of VALUE bits that is too short is
+   skipped as a whole, and so is every run of !VALUE bits. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
@@ -274,10 +350,20 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
+		size_t i = start;
+
+		if (cnt == 0)
+			return start <= last ? start : BITMAP_ERROR;
+		while (i <= last) {
+			i = find_next (b, i, value);
+			if (i > last)
+				break;
+
+			size_t run_end = find_next (b, i, !value);
+			if (run_end - i >= cnt)
 				return i;
+			i = run_end;
+		}
 	}
 	return BITMAP_ERROR;
 }
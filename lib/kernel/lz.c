@@ -0,0 +1,171 @@
+/* Fast LZ77 block compression.
+
+   See lz.h for basic information. */
+
+#include "lz.h"
+#include <string.h>
+#include "../debug.h"
+
+/* Largest distance back to a match. */
+#define MAX_DISTANCE 0xffff
+
+static uint32_t
+read32 (const uint8_t *p) {
+	uint32_t v;
+	memcpy (&v, p, sizeof v);
+	return v;
+}
+
+static size_t
+hash32 (uint32_t v) {
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Appends the extension bytes of a length whose nibble is 15,
+   LEN being the part beyond 15, to OP, if it stays below END.
+   Returns the new end of the output, or a null pointer if it
+   would not fit. */
+static uint8_t *
+put_length (uint8_t *op, uint8_t *end, size_t len) {
+	for (; len >= 255; len -= 255) {
+		if (op >= end)
+			return NULL;
+		*op++ = 255;
+	}
+	if (op >= end)
+		return NULL;
+	*op++ = len;
+	return op;
+}
+
+/* Appends a sequence of the LIT_LEN literals at LIT, followed,
+   unless MATCH_LEN is 0, by a match of MATCH_LEN bytes DISTANCE
+   back, to OP, if it stays below END.  Returns the new end of the
+   output, or a null pointer if it would not fit. */
+static uint8_t *
+put_sequence (uint8_t *op, uint8_t *end, const uint8_t *lit, size_t lit_len,
+		size_t distance, size_t match_len) {
+	size_t ml = match_len > 0 ? match_len - LZ_MIN_MATCH : 0;
+	uint8_t *token = op++;
+
+	if (token >= end)
+		return NULL;
+	*token = (lit_len < 15 ? lit_len : 15) << 4 | (ml < 15 ? ml : 15);
+	if (lit_len >= 15 && (op = put_length (op, end, lit_len - 15)) == NULL)
+		return NULL;
+	if ((size_t) (end - op) < lit_len)
+		return NULL;
+	memcpy (op, lit, lit_len);
+	op += lit_len;
+	if (match_len == 0)
+		return op;
+
+	if (end - op < 2)
+		return NULL;
+	*op++ = distance & 0xff;
+	*op++ = distance >> 8;
+	if (ml >= 15 && (op = put_length (op, end, ml - 15)) == NULL)
+		return NULL;
+	return op;
+}
+
+/* Compresses the SRC_LEN bytes at SRC into DST, which has room for
+   DST_CAP bytes, using the LZ_WORK_SIZE bytes at WORK as scratch
+   space.  Returns the size of the compressed block, or 0 if it
+   does not fit in DST_CAP bytes. */
+size_t
+lz_compress (const void *src_, size_t src_len,
+		void *dst_, size_t dst_cap, void *work) {
+	const uint8_t *src = src_;
+	uint8_t *dst = dst_;
+	uint8_t *op = dst, *end = dst + dst_cap;
+	uint16_t *table = work;         /* Position + 1 of each hash, 0 if none. */
+	size_t ip = 0, anchor = 0;
+
+	ASSERT (src_len <= 0xffff);
+
+	memset (table, 0, LZ_WORK_SIZE);
+	while (ip + LZ_MIN_MATCH <= src_len) {
+		uint32_t seq = read32 (src + ip);
+		size_t h = hash32 (seq);
+		size_t ref = table[h];
+		size_t len;
+
+		table[h] = ip + 1;
+		if (ref == 0 || ip - (ref - 1) > MAX_DISTANCE
+				|| read32 (src + ref - 1) != seq) {
+			ip++;
+			continue;
+		}
+		ref--;
+
+		len = LZ_MIN_MATCH;
+		while (ip + len < src_len && src[ref + len] == src[ip + len])
+			len++;
+		op = put_sequence (op, end, src + anchor, ip - anchor, ip - ref, len);
+		if (op == NULL)
+			return 0;
+		ip += len;
+		anchor = ip;
+	}
+
+	op = put_sequence (op, end, src + anchor, src_len - anchor, 0, 0);
+	return op != NULL ? (size_t) (op - dst) : 0;
+}
+
+/* Reads a length extension from *IP, which must stay below END,
+   adding it to *LEN.  Returns false if the input runs out. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *end, size_t *len) {
+	uint8_t b;
+
+	do {
+		if (*ip >= end)
+			return false;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return true;
+}
+
+/* Decompresses the SRC_LEN-byte block at SRC into DST.  Returns
+   true if it is well formed and expands to exactly DST_LEN
+   bytes. */
+bool
+lz_decompress (const void *src, size_t src_len, void *dst_, size_t dst_len) {
+	const uint8_t *ip = src, *end = ip + src_len;
+	uint8_t *dst = dst_;
+	size_t op = 0;
+
+	while (ip < end) {
+		uint8_t token = *ip++;
+		size_t lit_len = token >> 4;
+		size_t match_len = token & 15;
+		size_t distance;
+
+		if (lit_len == 15 && !get_length (&ip, end, &lit_len))
+			return false;
+		if ((size_t) (end - ip) < lit_len || dst_len - op < lit_len)
+			return false;
+		memcpy (dst + op, ip, lit_len);
+		ip += lit_len;
+		op += lit_len;
+		if (ip == end)
+			break;
+
+		if (end - ip < 2)
+			return false;
+		distance = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (match_len == 15 && !get_length (&ip, end, &match_len))
+			return false;
+		match_len += LZ_MIN_MATCH;
+		if (distance == 0 || distance > op || dst_len - op < match_len)
+			return false;
+
+		/* The match may overlap the bytes it produces. */
+		for (; match_len > 0; match_len--, op++)
+			dst[op] = dst[op - distance];
+	}
+	return op == dst_len;
+}
@@ -0,0 +1,438 @@
+/* Open-addressing hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include <string.h>
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Slots in a freshly initialized table. */
+#define INIT_SLOT_CNT 16
+
+/* Slots of the old table moved per insertion or deletion while a
+   resize is in progress.  Must be at least 8 so that the old
+   table (at most 7/8 full) is empty before the new one, twice its
+   size, can reach its own 7/8 limit. */
+#define DRAIN_STEP 8
+
+/* Index value meaning "no slot". */
+#define NO_SLOT ((size_t) -1)
+
+static uint64_t elem_hash (struct ohash *, const struct hash_elem *);
+static bool table_alloc (struct ohash_table *, size_t slot_cnt);
+static size_t table_find (struct ohash *, struct ohash_table *,
+		uint64_t hash, struct hash_elem *);
+static void table_put (struct ohash_table *, uint64_t hash,
+		struct hash_elem *);
+static void table_remove (struct ohash_table *, size_t idx);
+static struct ohash_slot *find_slot (struct ohash *, uint64_t hash,
+		struct hash_elem *, struct ohash_table **);
+static void make_room (struct ohash *);
+static void drain (struct ohash *, size_t slot_cnt);
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using LESS, given auxiliary data AUX. */
+bool
+ohash_init (struct ohash *h,
+		hash_hash_func *hash, hash_less_func *less, void *aux) {
+	h->hash = hash;
+	h->less = less;
+	h->aux = aux;
+	h->cur.slot_cnt = h->cur.elem_cnt = 0;
+	h->cur.slots = NULL;
+	h->old = h->cur;
+	h->drain_idx = 0;
+	return table_alloc (&h->cur, INIT_SLOT_CNT);
+}
+
+/* Removes all the elements from H.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the hash.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the hash element.  However, modifying hash
+   table H while ohash_clear() is running, using any of the
+   functions ohash_clear(), ohash_destroy(), ohash_insert(),
+   ohash_replace(), or ohash_delete(), yields undefined behavior,
+   whether done in DESTRUCTOR or elsewhere.
+
+   The slot array keeps its current size. */
+void
+ohash_clear (struct ohash *h, hash_action_func *destructor) {
+	if (destructor != NULL)
+		ohash_apply (h, destructor);
+
+	free (h->old.slots);
+	h->old.slot_cnt = h->old.elem_cnt = 0;
+	h->old.slots = NULL;
+	h->drain_idx = 0;
+
+	if (h->cur.slots != NULL)
+		memset (h->cur.slots, 0, sizeof *h->cur.slots * h->cur.slot_cnt);
+	h->cur.elem_cnt = 0;
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the hash, with the same semantics as a call to
+   ohash_clear(). */
+void
+ohash_destroy (struct ohash *h, hash_action_func *destructor) {
+	ohash_clear (h, destructor);
+	free (h->cur.slots);
+	h->cur.slots = NULL;
+	h->cur.slot_cnt = 0;
+}
+
+/* Inserts NEW into hash table H and returns a null pointer, if
+   no equal element is already in the table.
+   If an equal element is already in the table, returns it
+   without inserting NEW. */
+struct hash_elem *
+ohash_insert (struct ohash *h, struct hash_elem *new) {
+	uint64_t hash = elem_hash (h, new);
+	struct ohash_table *t;
+	struct ohash_slot *slot = find_slot (h, hash, new, &t);
+
+	if (slot != NULL)
+		return slot->elem;
+
+	make_room (h);
+	table_put (&h->cur, hash, new);
+	drain (h, DRAIN_STEP);
+	return NULL;
+}
+
+/* Inserts NEW into hash table H, replacing any equal element
+   already in the table, which is returned. */
+struct hash_elem *
+ohash_replace (struct ohash *h, struct hash_elem *new) {
+	uint64_t hash = elem_hash (h, new);
+	struct ohash_table *t;
+	struct ohash_slot *slot = find_slot (h, hash, new, &t);
+	struct hash_elem *old;
+
+	if (slot != NULL) {
+		/* Equal elements hash equally, so NEW takes over the slot
+		   without disturbing the probe order. */
+		old = slot->elem;
+		slot->elem = new;
+		return old;
+	}
+
+	make_room (h);
+	table_put (&h->cur, hash, new);
+	drain (h, DRAIN_STEP);
+	return NULL;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table. */
+struct hash_elem *
+ohash_find (struct ohash *h, struct hash_elem *e) {
+	struct ohash_table *t;
+	struct ohash_slot *slot = find_slot (h, elem_hash (h, e), e, &t);
+
+	return slot != NULL ? slot->elem : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table.
+
+   If the elements of the hash table are dynamically allocated,
+   or own resources that are, then it is the caller's
+   responsibility to deallocate them. */
+struct hash_elem *
+ohash_delete (struct ohash *h, struct hash_elem *e) {
+	struct ohash_table *t;
+	struct ohash_slot *slot = find_slot (h, elem_hash (h, e), e, &t);
+	struct hash_elem *found;
+
+	if (slot == NULL)
+		return NULL;
+
+	found = slot->elem;
+	table_remove (t, slot - t->slots);
+	drain (h, DRAIN_STEP);
+	return found;
+}
+
+/* Calls ACTION for each element in hash table H in arbitrary
+   order.
+   Modifying hash table H while ohash_apply() is running, using
+   any of the functions ohash_clear(), ohash_destroy(),
+   ohash_insert(), ohash_replace(), or ohash_delete(), yields
+   undefined behavior, whether done from ACTION or elsewhere. */
+void
+ohash_apply (struct ohash *h, hash_action_func *action) {
+	struct ohash_iterator i;
+
+	ASSERT (action != NULL);
+
+	ohash_first (&i, h);
+	while (ohash_next (&i))
+		action (ohash_cur (&i), h->aux);
+}
+
+/* Initializes I for iterating hash table H.
+
+   Iteration idiom:
+
+   struct ohash_iterator i;
+
+   ohash_first (&i, h);
+   while (ohash_next (&i))
+   {
+   struct foo *f = hash_entry (ohash_cur (&i), struct foo, elem);
+   ...do something with f...
+   }
+
+   Modifying hash table H during iteration, using any of the
+   functions ohash_clear(), ohash_destroy(), ohash_insert(),
+   ohash_replace(), or ohash_delete(), invalidates all
+   iterators. */
+void
+ohash_first (struct ohash_iterator *i, struct ohash *h) {
+	ASSERT (i != NULL);
+	ASSERT (h != NULL);
+
+	i->hash = h;
+	i->table = &h->old;
+	i->idx = NO_SLOT;
+	i->elem = NULL;
+}
+
+/* Advances I to the next element in the hash table and returns
+   it.  Returns a null pointer if no elements are left.  Elements
+   are returned in arbitrary order. */
+struct hash_elem *
+ohash_next (struct ohash_iterator *i) {
+	ASSERT (i != NULL);
+
+	for (;;) {
+		i->idx++;
+		if (i->idx < i->table->slot_cnt) {
+			if (i->table->slots[i->idx].elem != NULL)
+				return i->elem = i->table->slots[i->idx].elem;
+		} else if (i->table == &i->hash->old) {
+			i->table = &i->hash->cur;
+			i->idx = NO_SLOT;
+		} else
+			return i->elem = NULL;
+	}
+}
+
+/* Returns the current element in the hash table iteration, or a
+   null pointer at the end of the table.  Undefined behavior
+   after calling ohash_first() but before ohash_next(). */
+struct hash_elem *
+ohash_cur (struct ohash_iterator *i) {
+	return i->elem;
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (struct ohash *h) {
+	return h->cur.elem_cnt + h->old.elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+ohash_empty (struct ohash *h) {
+	return ohash_size (h) == 0;
+}
+
+/* Returns the hash of E, passed through a 64-bit finalizer.  The
+   sample hash functions in hash.c leave the low bits poorly mixed
+   for keys that differ only in their high bytes (such as page
+   addresses), and open addressing indexes by the low bits, so
+   consecutive keys would otherwise pile up into one long probe
+   run. */
+static uint64_t
+elem_hash (struct ohash *h, const struct hash_elem *e) {
+	uint64_t x = h->hash (e, h->aux);
+
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdUL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53UL;
+	x ^= x >> 33;
+	return x;
+}
+
+/* Makes T an empty table of SLOT_CNT slots, which must be a
+   power of 2.  Returns false and leaves T untouched if memory
+   is short. */
+static bool
+table_alloc (struct ohash_table *t, size_t slot_cnt) {
+	struct ohash_slot *slots = calloc (slot_cnt, sizeof *slots);
+
+	if (slots == NULL)
+		return false;
+	t->slots = slots;
+	t->slot_cnt = slot_cnt;
+	t->elem_cnt = 0;
+	return true;
+}
+
+/* Returns how far the entry in slot IDX of T is from the slot
+   its hash maps to. */
+static inline size_t
+probe_dist (const struct ohash_table *t, size_t idx) {
+	size_t mask = t->slot_cnt - 1;
+	return (idx - (t->slots[idx].hash & mask)) & mask;
+}
+
+/* Searches T for an element equal to E, whose hash is HASH.
+   Returns its slot index or NO_SLOT. */
+static size_t
+table_find (struct ohash *h, struct ohash_table *t, uint64_t hash,
+		struct hash_elem *e) {
+	size_t mask = t->slot_cnt - 1;
+	size_t idx, dist;
+
+	if (t->elem_cnt == 0)
+		return NO_SLOT;
+
+	for (idx = hash & mask, dist = 0; ; idx = (idx + 1) & mask, dist++) {
+		struct ohash_slot *slot = &t->slots[idx];
+
+		/* An empty slot, or an entry closer to home than E would
+		   be here, means E would have been placed before it. */
+		if (slot->elem == NULL || probe_dist (t, idx) < dist)
+			return NO_SLOT;
+		if (slot->hash == hash
+				&& !h->less (slot->elem, e, h->aux)
+				&& !h->less (e, slot->elem, h->aux))
+			return idx;
+	}
+}
+
+/* Puts E, whose hash is HASH, into T, which must have a free
+   slot.  Entries richer than E (closer to their home slot) are
+   shifted along to make way. */
+static void
+table_put (struct ohash_table *t, uint64_t hash, struct hash_elem *e) {
+	size_t mask = t->slot_cnt - 1;
+	size_t idx, dist;
+
+	ASSERT (t->elem_cnt < t->slot_cnt);
+
+	t->elem_cnt++;
+	for (idx = hash & mask, dist = 0; ; idx = (idx + 1) & mask, dist++) {
+		struct ohash_slot *slot = &t->slots[idx];
+		size_t slot_dist;
+
+		if (slot->elem == NULL) {
+			slot->hash = hash;
+			slot->elem = e;
+			return;
+		}
+
+		slot_dist = probe_dist (t, idx);
+		if (slot_dist < dist) {
+			struct ohash_slot displaced = *slot;
+
+			slot->hash = hash;
+			slot->elem = e;
+			hash = displaced.hash;
+			e = displaced.elem;
+			dist = slot_dist;
+		}
+	}
+}
+
+/* Empties slot IDX of T, shifting the entries after it back by
+   one until an empty slot or one already at home is reached. */
+static void
+table_remove (struct ohash_table *t, size_t idx) {
+	size_t mask = t->slot_cnt - 1;
+
+	t->elem_cnt--;
+	for (;;) {
+		size_t next = (idx + 1) & mask;
+
+		if (t->slots[next].elem == NULL || probe_dist (t, next) == 0)
+			break;
+		t->slots[idx] = t->slots[next];
+		idx = next;
+	}
+	t->slots[idx].elem = NULL;
+}
+
+/* Finds the slot holding an element equal to E, whose hash is
+   HASH, in either table of H.  Stores the table it was found in
+   into *T.  Returns a null pointer if there is none. */
+static struct ohash_slot *
+find_slot (struct ohash *h, uint64_t hash, struct hash_elem *e,
+		struct ohash_table **t) {
+	size_t idx = table_find (h, &h->cur, hash, e);
+
+	if (idx != NO_SLOT) {
+		*t = &h->cur;
+		return &h->cur.slots[idx];
+	}
+
+	idx = table_find (h, &h->old, hash, e);
+	if (idx != NO_SLOT) {
+		*t = &h->old;
+		return &h->old.slots[idx];
+	}
+	return NULL;
+}
+
+/* Makes sure H's current table can take one more element,
+   starting a resize if it is about to pass 7/8 full.  A failed
+   allocation is not an error as long as a free slot remains;
+   the table just gets slower. */
+static void
+make_room (struct ohash *h) {
+	struct ohash_table bigger;
+
+	if ((h->cur.elem_cnt + 1) * 8 <= h->cur.slot_cnt * 7)
+		return;
+
+	/* Only one resize at a time. */
+	drain (h, h->old.slot_cnt);
+
+	if (table_alloc (&bigger, h->cur.slot_cnt != 0
+				? h->cur.slot_cnt * 2 : INIT_SLOT_CNT)) {
+		h->old = h->cur;
+		h->cur = bigger;
+		h->drain_idx = 0;
+	} else if (h->cur.elem_cnt + 1 >= h->cur.slot_cnt)
+		PANIC ("ohash: out of memory growing a full table");
+}
+
+/* Moves the entries of up to SLOT_CNT slots of H's old table
+   into the current one, freeing the old table once it is
+   empty. */
+static void
+drain (struct ohash *h, size_t slot_cnt) {
+	if (h->old.slots == NULL)
+		return;
+
+	while (slot_cnt-- > 0 && h->drain_idx < h->old.slot_cnt) {
+		struct ohash_slot *slot = &h->old.slots[h->drain_idx];
+
+		/* Removing shifts later entries back into this slot, so
+		   keep going here until it stays empty. */
+		while (slot->elem != NULL) {
+			uint64_t hash = slot->hash;
+			struct hash_elem *e = slot->elem;
+
+			table_remove (&h->old, h->drain_idx);
+			table_put (&h->cur, hash, e);
+		}
+		h->drain_idx++;
+	}
+
+	if (h->drain_idx >= h->old.slot_cnt || h->old.elem_cnt == 0) {
+		free (h->old.slots);
+		h->old.slots = NULL;
+		h->old.slot_cnt = h->old.elem_cnt = 0;
+		h->drain_idx = 0;
+	}
+}
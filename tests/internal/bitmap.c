@@ -0,0 +1,165 @@
+/* Test program and microbenchmark for lib/kernel/bitmap.c.
+
+   Checks the word-at-a-time bitmap_scan(), bitmap_count(),
+   bitmap_contains() and bitmap_set_multiple() against simple
+   bit-by-bit reference versions built on bitmap_test(), then
+   times both on a bitmap the size of a user pool's used_map.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+#include "intrinsic.h"
+
+/* Maximum number of bits in a bitmap that we will test. */
+#define MAX_BITS 300
+
+/* Bits in the benchmark bitmap: 64 MB of 4 kB pages. */
+#define BENCH_BITS 16384
+
+/* Scans timed per benchmark. */
+#define BENCH_ROUNDS 64
+
+static size_t ref_scan (const struct bitmap *, size_t start, size_t cnt,
+                        bool value);
+static size_t ref_count (const struct bitmap *, size_t start, size_t cnt,
+                         bool value);
+static void fill_random (struct bitmap *, int density);
+static void bench (void);
+
+/* Test the bitmap implementation. */
+void
+test (void)
+{
+  size_t size;
+
+  printf ("testing various size bitmaps:");
+  for (size = 0; size < MAX_BITS; size += 7)
+    {
+      int repeat;
+
+      printf (" %zu", size);
+      for (repeat = 0; repeat < 40; repeat++)
+        {
+          struct bitmap *b = bitmap_create (size);
+          int query;
+
+          ASSERT (b != NULL);
+          fill_random (b, repeat % 4);
+          for (query = 0; query < 16; query++)
+            {
+              size_t start = random_ulong () % (size + 1);
+              size_t cnt = random_ulong () % (size - start + 1);
+              size_t run = random_ulong () % 20;
+              bool value = random_ulong () % 2;
+              size_t i;
+
+              ASSERT (bitmap_count (b, start, cnt, value)
+                      == ref_count (b, start, cnt, value));
+              ASSERT (bitmap_contains (b, start, cnt, value)
+                      == (ref_count (b, start, cnt, value) != 0));
+              ASSERT (bitmap_scan (b, start, run, value)
+                      == ref_scan (b, start, run, value));
+
+              bitmap_set_multiple (b, start, cnt, value);
+              for (i = start; i < start + cnt; i++)
+                ASSERT (bitmap_test (b, i) == value);
+            }
+          bitmap_destroy (b);
+        }
+    }
+  printf (" done\n");
+
+  bench ();
+  printf ("bitmap: PASS\n");
+}
+
+/* Times bitmap_scan() and bitmap_count() against the bit-by-bit
+   reference on a mostly full bitmap, the common case for palloc
+   under memory pressure. */
+static void
+bench (void)
+{
+  struct bitmap *b = bitmap_create (BENCH_BITS);
+  uint64_t start, word_cycles, bit_cycles;
+  int round;
+
+  ASSERT (b != NULL);
+  fill_random (b, 2);
+
+  start = rdtsc ();
+  for (round = 0; round < BENCH_ROUNDS; round++)
+    bitmap_scan (b, 0, 1 + round % 8, false);
+  word_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (round = 0; round < BENCH_ROUNDS; round++)
+    ref_scan (b, 0, 1 + round % 8, false);
+  bit_cycles = rdtsc () - start;
+  printf ("scan: %llu cycles word-at-a-time, %llu cycles bit-by-bit\n",
+          word_cycles / BENCH_ROUNDS, bit_cycles / BENCH_ROUNDS);
+
+  start = rdtsc ();
+  for (round = 0; round < BENCH_ROUNDS; round++)
+    bitmap_count (b, 0, BENCH_BITS, true);
+  word_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (round = 0; round < BENCH_ROUNDS; round++)
+    ref_count (b, 0, BENCH_BITS, true);
+  bit_cycles = rdtsc () - start;
+  printf ("count: %llu cycles word-at-a-time, %llu cycles bit-by-bit\n",
+          word_cycles / BENCH_ROUNDS, bit_cycles / BENCH_ROUNDS);
+
+  bitmap_destroy (b);
+}
+
+/* Sets the bits of B randomly.  DENSITY 0 gives about half set,
+   1 about a tenth set, 2 about nine tenths set, 3 none set. */
+static void
+fill_random (struct bitmap *b, int density)
+{
+  size_t i;
+
+  for (i = 0; i < bitmap_size (b); i++)
+    {
+      unsigned long r = random_ulong ();
+      bool value = (density == 0 ? r % 2
+                    : density == 1 ? r % 10 == 0
+                    : density == 2 ? r % 10 != 0
+                    : false);
+      bitmap_set (b, i, value);
+    }
+}
+
+/* Bit-by-bit bitmap_scan(). */
+static size_t
+ref_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t i;
+
+  if (cnt > bitmap_size (b))
+    return BITMAP_ERROR;
+  for (i = start; i + cnt <= bitmap_size (b); i++)
+    if (ref_count (b, i, cnt, value) == cnt)
+      return i;
+  return BITMAP_ERROR;
+}
+
+/* Bit-by-bit bitmap_count(). */
+static size_t
+ref_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t i, value_cnt = 0;
+
+  for (i = start; i < start + cnt; i++)
+    if (bitmap_test (b, i) == value)
+      value_cnt++;
+  return value_cnt;
+}
@@ -0,0 +1,174 @@
+/* Test program and microbenchmark for lib/kernel/ohash.c.
+
+   Runs the same random insert/delete/find sequence against the
+   open-addressing table and the chained table in hash.c and
+   checks that they always agree, then times lookups and
+   insertions of page-aligned keys in both, the access pattern of
+   the supplemental page table.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <ohash.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+#include "intrinsic.h"
+
+/* Number of distinct keys in the correctness test. */
+#define KEY_CNT 512
+
+/* Operations in the correctness test. */
+#define OP_CNT 20000
+
+/* Keys in the benchmark: a 16 MB address space of 4 kB pages. */
+#define BENCH_KEYS 4096
+
+/* A hash table element. */
+struct value
+  {
+    struct hash_elem elem;      /* Chained hash element. */
+    struct hash_elem oelem;     /* Open-addressing hash element. */
+    uint64_t key;               /* Page-aligned key. */
+  };
+
+static uint64_t value_hash (const struct hash_elem *, void *);
+static bool value_less (const struct hash_elem *, const struct hash_elem *,
+                        void *);
+static uint64_t ovalue_hash (const struct hash_elem *, void *);
+static bool ovalue_less (const struct hash_elem *, const struct hash_elem *,
+                         void *);
+static void bench (void);
+
+static struct value values[BENCH_KEYS];
+
+/* Test the open-addressing hash table implementation. */
+void
+test (void)
+{
+  struct hash chained;
+  struct ohash open;
+  int op;
+
+  ASSERT (hash_init (&chained, value_hash, value_less, NULL));
+  ASSERT (ohash_init (&open, ovalue_hash, ovalue_less, NULL));
+  for (op = 0; op < KEY_CNT; op++)
+    values[op].key = (uint64_t) op << 12;
+
+  printf ("testing random operations:");
+  for (op = 0; op < OP_CNT; op++)
+    {
+      struct value *v = &values[random_ulong () % KEY_CNT];
+      struct hash_elem *c, *o;
+
+      switch (random_ulong () % 4)
+        {
+        case 0:
+        case 1:
+          c = hash_insert (&chained, &v->elem);
+          o = ohash_insert (&open, &v->oelem);
+          break;
+        case 2:
+          c = hash_delete (&chained, &v->elem);
+          o = ohash_delete (&open, &v->oelem);
+          break;
+        default:
+          c = hash_find (&chained, &v->elem);
+          o = ohash_find (&open, &v->oelem);
+          break;
+        }
+      ASSERT ((c == NULL) == (o == NULL));
+      ASSERT (hash_size (&chained) == ohash_size (&open));
+      if (op % 2000 == 0)
+        printf (" %d", op);
+    }
+  printf (" done\n");
+
+  hash_destroy (&chained, NULL);
+  ohash_destroy (&open, NULL);
+
+  bench ();
+  printf ("hash: PASS\n");
+}
+
+/* Times inserting BENCH_KEYS page addresses into each table and
+   then looking every one of them up. */
+static void
+bench (void)
+{
+  struct hash chained;
+  struct ohash open;
+  uint64_t start, chained_cycles, open_cycles;
+  int i;
+
+  for (i = 0; i < BENCH_KEYS; i++)
+    values[i].key = 0x400000 + ((uint64_t) i << 12);
+
+  ASSERT (hash_init (&chained, value_hash, value_less, NULL));
+  start = rdtsc ();
+  for (i = 0; i < BENCH_KEYS; i++)
+    hash_insert (&chained, &values[i].elem);
+  chained_cycles = rdtsc () - start;
+
+  ASSERT (ohash_init (&open, ovalue_hash, ovalue_less, NULL));
+  start = rdtsc ();
+  for (i = 0; i < BENCH_KEYS; i++)
+    ohash_insert (&open, &values[i].oelem);
+  open_cycles = rdtsc () - start;
+  printf ("insert: %llu cycles chained, %llu cycles open addressing\n",
+          chained_cycles / BENCH_KEYS, open_cycles / BENCH_KEYS);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_KEYS; i++)
+    ASSERT (hash_find (&chained, &values[i].elem) != NULL);
+  chained_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_KEYS; i++)
+    ASSERT (ohash_find (&open, &values[i].oelem) != NULL);
+  open_cycles = rdtsc () - start;
+  printf ("find: %llu cycles chained, %llu cycles open addressing\n",
+          chained_cycles / BENCH_KEYS, open_cycles / BENCH_KEYS);
+
+  hash_destroy (&chained, NULL);
+  ohash_destroy (&open, NULL);
+}
+
+/* Hash and comparison functions for the chained table, the same
+   as the supplemental page table used before ohash. */
+static uint64_t
+value_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct value *v = hash_entry (e, struct value, elem);
+  return hash_bytes (&v->key, sizeof v->key);
+}
+
+static bool
+value_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = hash_entry (a_, struct value, elem);
+  const struct value *b = hash_entry (b_, struct value, elem);
+  return a->key < b->key;
+}
+
+/* Hash and comparison functions for the open-addressing table,
+   the same as the supplemental page table's. */
+static uint64_t
+ovalue_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_entry (e, struct value, oelem)->key;
+}
+
+static bool
+ovalue_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct value *a = hash_entry (a_, struct value, oelem);
+  const struct value *b = hash_entry (b_, struct value, oelem);
+  return a->key < b->key;
+}
@@ -0,0 +1,49 @@
+/* Spawns child-read, handing it a copy of an open file as fd 5,
+   and checks that the copy starts at the parent's position but
+   moves independently of it.  Spawning a missing program must
+   fail without a child to wait for. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/boundary.h"
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t pid;
+  int handle;
+  int byte_cnt;
+  char *buffer;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  buffer = get_boundary_area () - sizeof sample / 2;
+  CHECK ((byte_cnt = read (handle, buffer, 20)) == 20,
+         "read \"sample.txt\" first 20 bytes");
+
+  CHECK (spawn ("no-such-file", NULL) == PID_ERROR,
+         "spawn \"no-such-file\"");
+
+  struct spawn_fd fds[] = { { handle, 5 }, { SPAWN_FD_END, 0 } };
+  /* No message until the child is done: its output comes first. */
+  if ((pid = spawn ("child-read 5", fds)) == PID_ERROR)
+    fail ("spawn \"child-read 5\" failed");
+  CHECK (wait (pid) == 0, "wait for child");
+
+  byte_cnt = read (handle, buffer + 20, sizeof sample - 21);
+  if (byte_cnt != sizeof sample - 21)
+    fail ("read() returned %d instead of %zu", byte_cnt, sizeof sample - 21);
+  else if (strcmp (sample, buffer))
+    {
+      msg ("expected text:\n%s", sample);
+      msg ("text actually read:\n%s", buffer);
+      fail ("expected text differs from actual");
+    }
+  else
+    msg ("Parent success");
+
+  close (handle);
+}
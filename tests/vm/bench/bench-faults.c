@@ -0,0 +1,76 @@
+/* Reports the kernel's own service time, from faultstat(), for
+   each kind of page fault: reading untouched bss, writing it,
+   growing the stack, and reading a mapped file.  Regressions in
+   paging, swap and file I/O show up as separate lines. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench/bench.h"
+
+#define PAGE_SIZE 4096
+#define BSS_PAGES 128
+#define STACK_PAGES 32
+
+static char bss[BSS_PAGES * PAGE_SIZE];
+
+/* Reports the faults of KIND since BEFORE as WHAT, and updates
+   BEFORE. */
+static void
+report (const char *what, enum fault_kind kind, struct fault_stats *before)
+{
+  struct fault_stats after;
+  uint64_t count;
+
+  faultstat (&after, false);
+  count = after.count[kind] - before->count[kind];
+  bench_report (what, count > 0 ? count : 1,
+                after.cycles[kind] - before->cycles[kind]);
+  *before = after;
+}
+
+/* Touches STACK_PAGES new pages of stack, top down. */
+static int NO_INLINE
+grow_stack (void)
+{
+  volatile char frame[STACK_PAGES * PAGE_SIZE];
+  int i, sum = 0;
+
+  for (i = STACK_PAGES - 1; i >= 0; i--)
+    frame[i * PAGE_SIZE] = i;
+  for (i = 0; i < STACK_PAGES; i++)
+    sum += frame[i * PAGE_SIZE];
+  return sum;
+}
+
+void
+test_main (void)
+{
+  struct fault_stats stats;
+  volatile char sum = 0;
+  char *map = (char *) 0x10000000;
+  int handle, size, i;
+
+  faultstat (&stats, false);
+
+  for (i = 0; i < BSS_PAGES; i++)
+    sum += bss[i * PAGE_SIZE];
+  report ("bss read fault", FAULT_MINOR, &stats);
+
+  for (i = 0; i < BSS_PAGES; i++)
+    bss[i * PAGE_SIZE] = i;
+  report ("bss write fault", FAULT_COW, &stats);
+
+  sum += grow_stack ();
+  report ("stack growth fault", FAULT_STACK, &stats);
+
+  CHECK ((handle = open ("bench-faults")) > 1, "open \"bench-faults\"");
+  size = filesize (handle);
+  CHECK (mmap (map, size, 0, handle, 0) == map, "mmap \"bench-faults\"");
+  for (i = 0; i < size; i += PAGE_SIZE)
+    sum += map[i];
+  report ("file read fault", FAULT_MAJOR, &stats);
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::bench::bench;
+check_bench ("bench-faults",
+	     "bss read fault", "bss write fault", "stack growth fault",
+	     "file read fault");
@@ -0,0 +1,32 @@
+/* Ping-pongs between a parent and a freshly exec'd child: every
+   iteration is a fork, an exec and a wait, so the CPU keeps
+   switching between user address spaces.  With global kernel
+   pages and PCID-tagged address spaces those switches no longer
+   flush the whole TLB. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench/bench.h"
+
+#define ITERATIONS 32
+
+void
+test_main (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      pid_t pid = fork ("child-bench");
+      if (pid == 0)
+        {
+          exec ("child-bench");
+          fail ("exec child-bench failed");
+        }
+      if (wait (pid) != 0)
+        fail ("child-bench did not exit cleanly");
+    }
+  bench_report ("fork+exec+wait", ITERATIONS, rdtsc () - start);
+}
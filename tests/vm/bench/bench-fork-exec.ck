@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::bench::bench;
+check_bench ("bench-fork-exec", "fork+exec+wait");
@@ -0,0 +1,48 @@
+/* Times fork+wait with a growing amount of touched memory in the
+   parent.  With eager copying every fork duplicates each resident
+   page; with copy-on-write the child only gets read-only
+   mappings of the parent's frames, so the cost per fork should
+   stay nearly flat as the heap grows. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench/bench.h"
+
+#define ITERATIONS 16
+#define PAGE_SIZE 4096
+#define HEAP_PAGES 256
+
+static char heap[HEAP_PAGES * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  static const int sizes[] = { 0, 16, 64, HEAP_PAGES };
+  size_t s;
+
+  for (s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+      char what[64];
+      uint64_t start;
+      int i;
+
+      /* Make the first SIZES[S] pages resident and dirty. */
+      for (i = 0; i < sizes[s]; i++)
+        heap[i * PAGE_SIZE] = i;
+
+      start = rdtsc ();
+      for (i = 0; i < ITERATIONS; i++)
+        {
+          pid_t pid = fork ("child");
+          if (pid == 0)
+            exit (heap[0]);
+          if (wait (pid) != heap[0])
+            fail ("child saw a different heap");
+        }
+      snprintf (what, sizeof what, "fork+wait, %d kB heap",
+                sizes[s] * PAGE_SIZE / 1024);
+      bench_report (what, ITERATIONS, rdtsc () - start);
+    }
+}
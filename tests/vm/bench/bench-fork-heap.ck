@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::bench::bench;
+check_bench ("bench-fork-heap",
+	     "fork+wait, 0 kB heap", "fork+wait, 64 kB heap",
+	     "fork+wait, 256 kB heap", "fork+wait, 1024 kB heap");
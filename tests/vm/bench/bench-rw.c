@@ -0,0 +1,55 @@
+/* Times read and write system calls on a file across buffer
+   sizes, from a single byte to several pages.  The per-call cost
+   shows how much of it goes to checking and copying the user
+   buffer rather than to the file system. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench/bench.h"
+
+#define FILE_SIZE (64 * 1024)
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  static const int sizes[] = { 1, 64, 512, 4096, 16384, 65536 };
+  size_t s;
+  int handle;
+
+  CHECK (create ("data", FILE_SIZE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+
+  for (s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+      int size = sizes[s];
+      int calls = FILE_SIZE / size;
+      char what[64];
+      uint64_t start;
+      int i;
+
+      /* Don't let one-byte calls take all day. */
+      if (calls > 1024)
+        calls = 1024;
+
+      seek (handle, 0);
+      start = rdtsc ();
+      for (i = 0; i < calls; i++)
+        if (write (handle, buf + i * size % FILE_SIZE, size) != size)
+          fail ("write of %d bytes failed", size);
+      snprintf (what, sizeof what, "write %d bytes", size);
+      bench_report (what, calls, rdtsc () - start);
+
+      seek (handle, 0);
+      start = rdtsc ();
+      for (i = 0; i < calls; i++)
+        if (read (handle, buf + i * size % FILE_SIZE, size) != size)
+          fail ("read of %d bytes failed", size);
+      snprintf (what, sizeof what, "read %d bytes", size);
+      bench_report (what, calls, rdtsc () - start);
+    }
+  close (handle);
+}
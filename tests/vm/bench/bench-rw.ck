@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::bench::bench;
+check_bench ("bench-rw",
+	     map { ("write $_ bytes", "read $_ bytes") }
+	     1, 64, 512, 4096, 16384, 65536);
@@ -0,0 +1,49 @@
+/* Starts child-bench over and over, once with fork+exec and once
+   with spawn, and waits for it each time.  fork() copies the
+   parent's page table and fd table only for exec() to throw them
+   away; spawn() loads the program into an empty process. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench/bench.h"
+
+#define ITERATIONS 32
+
+/* Some memory for fork() to copy, as a real launcher would have. */
+static char heap[64 * 4096];
+
+void
+test_main (void)
+{
+  uint64_t start;
+  size_t i;
+
+  for (i = 0; i < sizeof heap; i += 4096)
+    heap[i] = 1;
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      pid_t pid = fork ("child-bench");
+      if (pid == 0)
+        {
+          exec ("child-bench");
+          fail ("exec child-bench failed");
+        }
+      if (wait (pid) != 0)
+        fail ("child-bench did not exit cleanly");
+    }
+  bench_report ("fork+exec+wait", ITERATIONS, rdtsc () - start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      pid_t pid = spawn ("child-bench", NULL);
+      if (pid == PID_ERROR)
+        fail ("spawn child-bench failed");
+      if (wait (pid) != 0)
+        fail ("child-bench did not exit cleanly");
+    }
+  bench_report ("spawn+wait", ITERATIONS, rdtsc () - start);
+}
@@ -0,0 +1,26 @@
+#ifndef TESTS_VM_BENCH_BENCH_H
+#define TESTS_VM_BENCH_BENCH_H
+
+#include <stdint.h>
+#include "tests/lib.h"
+
+/* Reads the CPU time-stamp counter.  RDTSC is allowed in user
+   mode because Pintos never sets CR4.TSD. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Reports CYCLES spent on ITERATIONS rounds of WHAT in the
+   format bench.pm expects. */
+static inline void
+bench_report (const char *what, int iterations, uint64_t cycles)
+{
+  msg ("%s: %d iterations, %llu cycles/iteration",
+       what, iterations, (unsigned long long) (cycles / iterations));
+}
+
+#endif /* tests/vm/bench/bench.h */
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# Benchmarks are not graded on their numbers.  They pass as long
+# as the kernel survives and every expected timing line shows up.
+sub check_bench {
+    my ($proc_name, @whats) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+    fail "First line of output is not `($proc_name) begin' message.\n"
+      if $output[0] ne "($proc_name) begin";
+    foreach my $what (@whats) {
+	fail "Output missing timing line for `$what'.\n"
+	  if !grep (/^\($proc_name\) \Q$what\E: \d+ iterations, \d+ cycles\/iteration$/, @output);
+    }
+    fail "Output missing `($proc_name) end' message.\n"
+      if !grep ("($proc_name) end" eq $_, @output);
+    pass;
+}
+
+1;
@@ -0,0 +1,11 @@
+/* Child process exec'd by the fork/exec benchmarks.
+   Terminates right away so that only process setup and
+   teardown are measured. */
+
+#include "tests/lib.h"
+
+int
+main (void)
+{
+  return 0;
+}
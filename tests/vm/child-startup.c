@@ -0,0 +1,24 @@
+/* Child process of startup-prefetch.
+   Reads every page of a large initialized array, so that it
+   starts up with a burst of faults on its own executable. */
+
+#include "tests/lib.h"
+
+const char *test_name = "child-startup";
+
+#define PAGE_SIZE 4096
+#define PAGES 48
+
+/* Initialized, so that it is stored in the executable. */
+static char data[PAGES * PAGE_SIZE] = { 1 };
+
+int
+main (void)
+{
+  volatile char sum = 0;
+  size_t i;
+
+  for (i = 0; i < PAGES; i++)
+    sum += data[i * PAGE_SIZE];
+  return sum != 1;
+}
@@ -0,0 +1,50 @@
+/* Forks while a three-page buffer is shared copy-on-write, has the
+   child read() a file into it with one call that starts and ends
+   in the middle of a page, and checks that none of the parent's
+   pages changed. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define OFS 100
+#define SIZE (2 * 4096 + 200)
+
+static char buf[3][4096];
+static char check[SIZE];
+
+void
+test_main (void)
+{
+  pid_t child;
+  int i;
+  size_t j;
+
+  for (i = 0; i < 3; i++)
+    memset (buf[i], 'a' + i, sizeof buf[i]);
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      int handle;
+
+      if ((handle = open ("large.txt")) < 2)
+        fail ("open \"large.txt\" failed");
+      if (read (handle, buf[0] + OFS, SIZE) != SIZE)
+        fail ("read into shared buffer came up short");
+      seek (handle, 0);
+      if (read (handle, check, SIZE) != SIZE)
+        fail ("read into private buffer came up short");
+      if (memcmp (buf[0] + OFS, check, SIZE))
+        fail ("read into shared buffer reported bad data");
+      exit (81);
+    }
+  CHECK (wait (child) == 81, "wait for child");
+
+  for (i = 0; i < 3; i++)
+    for (j = 0; j < sizeof buf[i]; j++)
+      if (buf[i][j] != 'a' + i)
+        fail ("byte %zu of parent's page %d is %02hhx", j, i, buf[i][j]);
+  msg ("parent's buffer is unchanged");
+}
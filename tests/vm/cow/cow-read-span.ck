@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-read-span) begin
+(cow-read-span) wait for child
+(cow-read-span) parent's buffer is unchanged
+(cow-read-span) end
+EOF
+pass;
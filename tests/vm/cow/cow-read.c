@@ -0,0 +1,47 @@
+/* Forks while a buffer is shared copy-on-write, has the child
+   read() a file into it, and checks that the parent's copy is
+   unchanged, in the parent's frame. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[4096];
+
+void
+test_main (void)
+{
+  size_t size = strlen (sample);
+  void *pa_parent;
+  pid_t child;
+  size_t i;
+
+  memset (buf, 'p', sizeof buf);
+  pa_parent = get_phys_addr (buf);
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      int handle;
+
+      if (get_phys_addr (buf) != pa_parent)
+        fail ("buffer is not shared after fork");
+      if ((handle = open ("sample.txt")) < 2)
+        fail ("open \"sample.txt\" failed");
+      if (read (handle, buf, size) != (int) size)
+        fail ("read of \"sample.txt\" came up short");
+      if (memcmp (buf, sample, size))
+        fail ("read of \"sample.txt\" reported bad data");
+      if (get_phys_addr (buf) == pa_parent)
+        fail ("read() wrote into the shared frame");
+      exit (81);
+    }
+  CHECK (wait (child) == 81, "wait for child");
+
+  for (i = 0; i < sizeof buf; i++)
+    if (buf[i] != 'p')
+      fail ("byte %zu of parent's buffer is %02hhx", i, buf[i]);
+  msg ("parent's buffer is unchanged");
+}
@@ -0,0 +1,75 @@
+/* Fills many pages with the same two patterns and waits, with the
+   merging thread enabled by -ksm, until two of the pages share a
+   frame.  Then writes into one of them and checks that the other
+   kept its data, writes a different byte into each page and checks
+   that every page kept its own data, in this process and in a
+   child forked after the writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 32
+#define MAX_ROUNDS 4000
+
+static char buf[PAGE_CNT][4096];
+
+/* Checks that page I holds its pattern, with MARK at offset I if
+   MARKED. */
+static void
+check_page (int i, bool marked)
+{
+  char pattern = 'a' + i % 2;
+  size_t j;
+
+  for (j = 0; j < sizeof buf[i]; j++)
+    {
+      char expected = marked && j == (size_t) i ? 'A' + i : pattern;
+      if (buf[i][j] != expected)
+        fail ("byte %zu of page %d is %02hhx, not %02hhx",
+              j, i, buf[i][j], expected);
+    }
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+  int i, r;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    memset (buf[i], 'a' + i % 2, sizeof buf[i]);
+  msg ("filled pages");
+
+  /* Pages 0 and 2 hold the same data. */
+  for (r = 0; get_phys_addr (buf[0]) != get_phys_addr (buf[2]); r++)
+    {
+      if (r == MAX_ROUNDS)
+        fail ("pages were never merged");
+      for (i = 0; i < PAGE_CNT; i++)
+        check_page (i, false);
+    }
+  msg ("pages merged");
+
+  buf[0][0] = 'A';
+  if (get_phys_addr (buf[0]) == get_phys_addr (buf[2]))
+    fail ("write to a merged page did not copy it");
+  check_page (0, true);
+  check_page (2, false);
+  msg ("write to merged page copied it");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i][i] = 'A' + i;
+  for (i = 0; i < PAGE_CNT; i++)
+    check_page (i, true);
+  msg ("wrote pages");
+
+  if ((child = fork ("child")) == 0)
+    {
+      for (i = 0; i < PAGE_CNT; i++)
+        check_page (i, true);
+      exit (81);
+    }
+  CHECK (wait (child) == 81, "wait for child");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-merge) begin
+(ksm-merge) filled pages
+(ksm-merge) pages merged
+(ksm-merge) write to merged page copied it
+(ksm-merge) wrote pages
+(ksm-merge) wait for child
+(ksm-merge) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* Locks a page in memory, reads a file into it and writes it back
+   out to another file while it is locked, then checks that mlock
+   fails on unmapped memory and over the per-process limit, and
+   that mlockall locks the whole (small) address space. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define LARGE_SIZE 2002990
+
+static char space[2 * 4096];
+static char check[4096];
+
+void
+test_main (void)
+{
+  char *page = (char *) (((uintptr_t) space + 4095) & ~(uintptr_t) 4095);
+  size_t size = strlen (sample);
+  int handle;
+  void *map;
+
+  CHECK (mlock (page, 4096) == 0, "mlock one page");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  if (read (handle, page, size) != (int) size)
+    fail ("read of \"sample.txt\" came up short");
+  if (memcmp (page, sample, size))
+    fail ("read of \"sample.txt\" into locked page reported bad data");
+  close (handle);
+
+  CHECK (create ("copy", size), "create \"copy\"");
+  CHECK ((handle = open ("copy")) > 1, "open \"copy\"");
+  if (write (handle, page, size) != (int) size)
+    fail ("write of \"copy\" came up short");
+  seek (handle, 0);
+  if (read (handle, check, size) != (int) size)
+    fail ("read of \"copy\" came up short");
+  if (memcmp (check, sample, size))
+    fail ("write from locked page reported bad data");
+  close (handle);
+
+  CHECK (munlock (page, 4096) == 0, "munlock one page");
+  CHECK (mlock (ACTUAL, 4096) == -1, "mlock unmapped page fails");
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK ((map = mmap (ACTUAL, LARGE_SIZE, 0, handle, 0)) != MAP_FAILED,
+         "mmap \"large.txt\"");
+  CHECK (mlock (map, LARGE_SIZE) == -1, "mlock over the limit fails");
+  munmap (map);
+  close (handle);
+
+  CHECK (mlockall () == 0, "mlockall");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mlock) begin
+(mlock) mlock one page
+(mlock) open "sample.txt"
+(mlock) create "copy"
+(mlock) open "copy"
+(mlock) munlock one page
+(mlock) mlock unmapped page fails
+(mlock) open "large.txt"
+(mlock) mmap "large.txt"
+(mlock) mlock over the limit fails
+(mlock) mlockall
+(mlock) end
+EOF
+pass;
@@ -0,0 +1,49 @@
+/* Writes to a file through a mapping, flushes it with msync, and
+   reads the data in the file back using the read system call while
+   it is still mapped, first for the whole mapping and then for one
+   page of it. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+#define SIZE (3 * 4096 + 100)
+
+static char buf[SIZE];
+
+static void
+check_data (int handle, char c)
+{
+  size_t i;
+
+  seek (handle, 0);
+  if (read (handle, buf, SIZE) != SIZE)
+    fail ("read of \"data\" came up short");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (i / 4096 == 1 ? c : 'a'))
+      fail ("byte %zu of \"data\" has value %02hhx", i, buf[i]);
+}
+
+void
+test_main (void)
+{
+  int handle;
+  void *map;
+
+  CHECK (create ("data", SIZE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  CHECK ((map = mmap (ACTUAL, SIZE, 1, handle, 0)) != MAP_FAILED, "mmap \"data\"");
+
+  memset (ACTUAL, 'a', SIZE);
+  CHECK (msync (ACTUAL, SIZE) == 0, "msync whole mapping");
+  check_data (handle, 'a');
+
+  memset (ACTUAL + 4096, 'b', 4096);
+  CHECK (msync (ACTUAL + 4096, 4096) == 0, "msync one page");
+  check_data (handle, 'b');
+
+  munmap (map);
+  close (handle);
+}
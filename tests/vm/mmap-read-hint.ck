@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-read-hint) begin
+(mmap-read-hint) open "sample.txt"
+(mmap-read-hint) mmap "sample.txt"
+(mmap-read-hint) madvise sequential
+(mmap-read-hint) madvise willneed
+(mmap-read-hint) madvise dontneed
+(mmap-read-hint) end
+pass;
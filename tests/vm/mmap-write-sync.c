@@ -0,0 +1,39 @@
+/* Maps a file, faults the mapping in, then overwrites part of the
+   file with the write system call and checks that the mapping shows
+   the new data while it stays mapped. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+#define SIZE (3 * 4096)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  int handle;
+  void *map;
+  size_t i;
+
+  CHECK (create ("data", SIZE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  CHECK ((map = mmap (ACTUAL, SIZE, 1, handle, 0)) != MAP_FAILED, "mmap \"data\"");
+
+  memset (ACTUAL, 'a', SIZE);
+  CHECK (msync (ACTUAL, SIZE) == 0, "msync mapping");
+
+  /* Straddles the first two pages. */
+  memset (buf, 'b', 4096);
+  seek (handle, 2048);
+  CHECK (write (handle, buf, 4096) == 4096, "write \"data\"");
+  for (i = 0; i < SIZE; i++)
+    if (ACTUAL[i] != (i >= 2048 && i < 2048 + 4096 ? 'b' : 'a'))
+      fail ("byte %zu of mapping has value %02hhx", i, ACTUAL[i]);
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-write-sync) begin
+(mmap-write-sync) create "data"
+(mmap-write-sync) open "data"
+(mmap-write-sync) mmap "data"
+(mmap-write-sync) msync mapping
+(mmap-write-sync) write "data"
+(mmap-write-sync) end
+EOF
+pass;
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-linear-hint) begin
+(page-linear-hint) madvise sequential
+(page-linear-hint) initialize
+(page-linear-hint) read pass
+(page-linear-hint) read/modify/write pass one
+(page-linear-hint) read/modify/write pass two
+(page-linear-hint) read pass
+(page-linear-hint) madvise dontneed
+(page-linear-hint) end
+pass;
@@ -0,0 +1,36 @@
+/* Runs the same program twice and checks that the second run,
+   whose startup pages the kernel reads in from the first run's
+   trace before it enters user mode, takes fewer major faults. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Returns the major faults the system took while running
+   child-startup once. */
+static uint64_t
+run_child (void)
+{
+  struct fault_stats before, after;
+  pid_t pid;
+
+  faultstat (&before, true);
+  if ((pid = spawn ("child-startup", NULL)) == PID_ERROR)
+    fail ("spawn child-startup failed");
+  if (wait (pid) != 0)
+    fail ("child-startup did not exit cleanly");
+  faultstat (&after, true);
+  return after.count[FAULT_MAJOR] - before.count[FAULT_MAJOR];
+}
+
+void
+test_main (void)
+{
+  uint64_t first = run_child ();
+  uint64_t second = run_child ();
+
+  if (second >= first)
+    fail ("%llu major faults on the second run, %llu on the first",
+          (unsigned long long) second, (unsigned long long) first);
+  msg ("second run took fewer major faults");
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(startup-prefetch) begin
+(startup-prefetch) second run took fewer major faults
+(startup-prefetch) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Touches a number of pages and checks that the kernel's
+   working-set estimate counts them all, then keeps using only a
+   few of them and checks that the estimate drops once the others
+   have aged out. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 64
+#define HOT 8                   /* Pages kept in use. */
+#define SPIN (1 << 20)          /* Loop iterations per round. */
+#define MAX_ROUNDS 2000         /* Rounds to wait for the aging. */
+
+static char buf[PAGES * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  size_t i, round, ws;
+  volatile int spin;
+
+  for (i = 0; i < PAGES; i++)
+    buf[i * PAGE_SIZE] = i;
+  ws = workingset ();
+  if (ws < PAGES)
+    fail ("working set of %zu pages, but touched %d", ws, PAGES);
+  msg ("working set covers touched pages");
+
+  /* Several aging periods go by while we spin. */
+  for (round = 0; round < MAX_ROUNDS; round++)
+    {
+      for (i = 0; i < HOT; i++)
+        buf[i * PAGE_SIZE]++;
+      for (spin = 0; spin < SPIN; spin++)
+        continue;
+      ws = workingset ();
+      if (ws < PAGES / 2)
+        break;
+    }
+  if (ws >= PAGES / 2)
+    fail ("working set still %zu pages with %d in use", ws, HOT);
+  if (ws < HOT)
+    fail ("working set of %zu pages, but %d are in use", ws, HOT);
+  msg ("working set dropped to pages in use");
+}
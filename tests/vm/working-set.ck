@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(working-set) begin
+(working-set) working set covers touched pages
+(working-set) working set dropped to pages in use
+(working-set) end
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Reads a file into a buffer whose page was first only read, and
+   so is mapped to the shared zero page, then checks that another
+   untouched page still reads back as zeros. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[2][4096];
+
+void
+test_main (void)
+{
+  size_t size = strlen (sample);
+  volatile char c;
+  int handle;
+  size_t i;
+
+  c = buf[0][0];
+  if (c != 0)
+    fail ("fresh page is not zero");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  if (read (handle, buf[0], size) != (int) size)
+    fail ("read of \"sample.txt\" came up short");
+  if (memcmp (buf[0], sample, size))
+    fail ("read of \"sample.txt\" reported bad data");
+  close (handle);
+
+  for (i = 0; i < sizeof buf[1]; i++)
+    if (buf[1][i] != 0)
+      fail ("byte %zu of untouched page is %02hhx", i, buf[1][i]);
+  msg ("untouched page is still zero");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zero-page-read) begin
+(zero-page-read) open "sample.txt"
+(zero-page-read) untouched page is still zero
+(zero-page-read) end
+EOF
+pass;
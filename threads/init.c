@@ -152,19 +152,37 @@ paging_init (uint64_t mem_end) {
 	extern char start, _end_kernel_text;
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	// Aligned 2 MB chunks get a single large PDE, like the loader's boot
+	// page tables in start.S.  Chunks overlapping the (read-only) kernel
+	// text and the unaligned tail fall back to 4 kB pages.
+	// Every kernel mapping is global (PTE_G) so that switching between
+	// user page tables does not flush it from the TLB.
+	for (uint64_t pa = 0; pa < mem_end; ) {
 		uint64_t va = (uint64_t) ptov(pa);
 
-		perm = PTE_P | PTE_W;
+		if (pa % LPGSIZE == 0 && pa + LPGSIZE <= mem_end
+				&& (va + LPGSIZE <= (uint64_t) &start
+					|| (uint64_t) &_end_kernel_text <= va)) {
+			if ((pte = pml4e_walk_pde (pml4, va, 1)) != NULL)
+				*pte = pa | PTE_P | PTE_W | PTE_G | PTE_PS;
+			pa += LPGSIZE;
+			continue;
+		}
+
+		perm = PTE_P | PTE_W | PTE_G;
 		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
 			perm &= ~PTE_W;
 
 		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
 			*pte = pa | perm;
+		pa += PGSIZE;
 	}
 
 	// reload cr3
 	pml4_activate(0);
+
+	// kernel mappings are global from now on, user ones get PCIDs
+	pml4_tlb_init ();
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -226,6 +244,18 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-fa"))
+			fault_around_pages = atoi (value);
+		else if (!strcmp (name, "-zswap"))
+			zswap_max_pages = atoi (value);
+		else if (!strcmp (name, "-mlock"))
+			mlock_max_pages = atoi (value);
+		else if (!strcmp (name, "-ksm"))
+			merge_scan_pages = atoi (value);
+		else if (!strcmp (name, "-fstats"))
+			fault_stats_print = true;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -328,6 +358,13 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -fa=PAGES          Map up to PAGES pages per file-backed fault.\n"
+			"  -zswap=PAGES       Keep up to PAGES pages of compressed swap in RAM.\n"
+			"  -mlock=PAGES       Let processes lock up to PAGES pages in memory.\n"
+			"  -ksm=PAGES         Scan PAGES frames per 1/10 s for pages to merge.\n"
+			"  -fstats            Print each process's page faults when it exits.\n"
 #endif
 			);
 	power_off ();
@@ -362,4 +399,7 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+#endif
 }
@@ -6,8 +6,35 @@
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "threads/interrupt.h"
 #include "intrinsic.h"
 
+/* PCID (process-context identifier) tagged address spaces.
+ * When the CPU supports it, each user pml4 gets a PCID, so that
+ * switching between processes reloads CR3 without flushing the TLB
+ * entries of the other address spaces.  PCID 0 is kept for base_pml4.
+ * A pml4 keeps its PCID until it is destroyed or the PCID is stolen
+ * for another pml4, in which case the next load of CR3 flushes it. */
+#define PCID_CNT 64
+
+struct pcid_slot
+{
+	uint64_t *pml4; /* Owner of this PCID, NULL if free. */
+	bool stale;		/* TLB may hold stale entries tagged with it. */
+};
+
+static bool pcid_enabled;
+static struct pcid_slot pcid_slots[PCID_CNT];
+static unsigned pcid_victim = 1; // next slot to steal when all are taken
+
+static struct pcid_slot *pcid_lookup(uint64_t *pml4);
+static void tlb_invalidate(uint64_t *pml4, const void *vpage);
+static void tlb_flush(uint64_t *pml4);
+
+/* Above this many pages, pml4_clear_range() flushes the whole TLB
+ * instead of issuing one invlpg per page. */
+#define INVLPG_MAX 32
+
 // pdp = page directory page
 static uint64_t *
 pgdir_walk(uint64_t *pdp, const uint64_t va, int create)
@@ -30,6 +57,9 @@ pgdir_walk(uint64_t *pdp, const uint64_t va, int create)
 			else
 				return NULL;
 		}
+		// large page - no page table below, the PDE itself is the leaf
+		if (pdp[idx] & PTE_PS)
+			return &pdp[idx];
 		// returns kernel virtual address mapped to the physical frame that va points to
 		return (uint64_t *)ptov(PTE_ADDR(pdp[idx]) + 8 * PTX(va)); // 8 = size of minimum addressable unit
 	}
@@ -112,6 +142,34 @@ pml4e_walk(uint64_t *pml4e, const uint64_t va, int create)
 	return pte;
 }
 
+/* Returns the address of the page directory entry for virtual
+ * address VA in page map level 4, pml4.  This is the slot where a
+ * 2 MB large page (PTE_PS) is installed.  If CREATE is true, missing
+ * page directory pointer and page directory tables are created;
+ * otherwise a null pointer is returned for them. */
+uint64_t *
+pml4e_walk_pde(uint64_t *pml4e, const uint64_t va, int create)
+{
+	uint64_t *table = pml4e;
+	const int idx[2] = {PML4(va), PDPE(va)};
+
+	for (int level = 0; level < 2; level++)
+	{
+		uint64_t *entry = &table[idx[level]];
+		if (!(*entry & PTE_P))
+		{
+			if (!create)
+				return NULL;
+			uint64_t *new_page = palloc_get_page(PAL_ZERO);
+			if (new_page == NULL)
+				return NULL;
+			*entry = vtop(new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov(PTE_ADDR(*entry));
+	}
+	return &table[PDX(va)];
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -155,10 +213,21 @@ pgdir_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux,
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
 	{
 		uint64_t *pte = ptov((uint64_t *)pdp[i]);
-		if (((uint64_t)pte) & PTE_P)
-			if (!pt_for_each((uint64_t *)PTE_ADDR(pte), func, aux,
-							 pml4_index, pdp_index, i))
+		if (!(((uint64_t)pte) & PTE_P))
+			continue;
+
+		if (pdp[i] & PTE_PS)
+		{
+			// large page leaf - FUNC gets the PDE, check PTE_PS on it
+			void *va = (void *)(((uint64_t)pml4_index << PML4SHIFT) |
+								((uint64_t)pdp_index << PDPESHIFT) |
+								((uint64_t)i << PDXSHIFT));
+			if (!func(&pdp[i], va, aux))
 				return false;
+		}
+		else if (!pt_for_each((uint64_t *)PTE_ADDR(pte), func, aux,
+							  pml4_index, pdp_index, i))
+			return false;
 	}
 	return true;
 }
@@ -178,7 +247,8 @@ pdp_for_each(uint64_t *pdp,
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * For a 2 MB large page, FUNC is called once with its PDE. */
 bool pml4_for_each(uint64_t *pml4, pte_for_each_func *func, void *aux)
 {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
@@ -191,40 +261,65 @@ bool pml4_for_each(uint64_t *pml4, pte_for_each_func *func, void *aux)
 	return true;
 }
 
-static void
-pt_destroy(uint64_t *pt)
+/* Returns true if no entry of page table TABLE is present. */
+static bool
+table_is_empty(const uint64_t *table)
 {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
-	{
-		uint64_t *pte = ptov((uint64_t *)pt[i]);
-		if (((uint64_t)pte) & PTE_P)
-			palloc_free_page((void *)PTE_ADDR(pte));
-	}
-	palloc_free_page((void *)pt);
+		if (table[i] & PTE_P)
+			return false;
+	return true;
 }
 
-static void
-pgdir_destroy(uint64_t *pdp)
+/* Clears the entries of TABLE, a paging structure at LEVEL (3 = pml4,
+ * 2 = pdp, 1 = page directory, 0 = page table) that maps virtual
+ * addresses from BASE, which fall in [START, END).  Lower-level tables
+ * are walked once and freed when the range covers them or they become
+ * empty.  Entries shared with base_pml4 (kernel space) are skipped.
+ * If FREE_FRAMES, the frames mapped by cleared PTEs are freed too.
+ * Returns the number of 4 kB PTEs cleared. */
+static size_t
+clear_range(uint64_t *table, int level, uint64_t base,
+			uint64_t start, uint64_t end, bool free_frames)
 {
-	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
-	{
-		uint64_t *pte = ptov((uint64_t *)pdp[i]);
-		if (((uint64_t)pte) & PTE_P)
-			pt_destroy(PTE_ADDR(pte));
-	}
-	palloc_free_page((void *)pdp);
-}
+	const unsigned shift = PTXSHIFT + 9 * level;
+	size_t cleared = 0;
 
-static void
-pdpe_destroy(uint64_t *pdpe)
-{
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
 	{
-		uint64_t *pde = ptov((uint64_t *)pdpe[i]);
-		if (((uint64_t)pde) & PTE_P)
-			pgdir_destroy((void *)PTE_ADDR(pde));
+		uint64_t lo = base + ((uint64_t)i << shift);
+		uint64_t hi = lo + (1UL << shift);
+		uint64_t *entry = &table[i];
+
+		if (hi <= start || end <= lo || !(*entry & PTE_P))
+			continue;
+		if (level == 3 && *entry == base_pml4[i])
+			continue;
+
+		if (level == 0)
+		{
+			if (free_frames)
+				palloc_free_page(ptov(PTE_ADDR(*entry)));
+			*entry = 0;
+			cleared++;
+		}
+		else if (*entry & PTE_PS)
+		{
+			if (start <= lo && hi <= end)
+				*entry = 0;
+		}
+		else
+		{
+			uint64_t *child = ptov(PTE_ADDR(*entry));
+			cleared += clear_range(child, level - 1, lo, start, end, free_frames);
+			if ((start <= lo && hi <= end) || table_is_empty(child))
+			{
+				palloc_free_page(child);
+				*entry = 0;
+			}
+		}
 	}
-	palloc_free_page((void *)pdpe);
+	return cleared;
 }
 
 /* Destroys pml4e, freeing all the pages it references. */
@@ -234,18 +329,131 @@ void pml4_destroy(uint64_t *pml4)
 		return;
 	ASSERT(pml4 != base_pml4);
 
-	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
-	uint64_t *pdpe = ptov((uint64_t *)pml4[0]);
-	if (((uint64_t)pdpe) & PTE_P)
-		pdpe_destroy((void *)PTE_ADDR(pdpe));
+	/* Tear down every user mapping and page table in one walk; kernel
+	 * entries are shared with base_pml4 and left alone.  With VM, user
+	 * frames belong to the frame table and are freed with their pages. */
+#ifdef VM
+	clear_range(pml4, 3, 0, 0, KERN_BASE, false);
+#else
+	clear_range(pml4, 3, 0, 0, KERN_BASE, true);
+#endif
+
+	/* Give the PCID back; its next owner flushes it on first load. */
+	enum intr_level old_level = intr_disable();
+	struct pcid_slot *slot = pcid_lookup(pml4);
+	if (slot != NULL)
+		slot->pml4 = NULL;
+	intr_set_level(old_level);
+
 	palloc_free_page((void *)pml4);
 }
 
+/* Returns the PCID slot owned by PML4, or NULL if it has none.
+ * Interrupts must be off. */
+static struct pcid_slot *
+pcid_lookup(uint64_t *pml4)
+{
+	for (unsigned i = 1; i < PCID_CNT; i++)
+		if (pcid_slots[i].pml4 == pml4)
+			return &pcid_slots[i];
+	return NULL;
+}
+
+/* Returns the PCID for PML4, assigning a free or stolen one if
+ * needed.  Sets *FLUSH if the TLB entries tagged with it must be
+ * dropped when it is loaded.  Interrupts must be off. */
+static unsigned
+pcid_get(uint64_t *pml4, bool *flush)
+{
+	struct pcid_slot *slot = pcid_lookup(pml4);
+
+	if (slot == NULL)
+	{
+		slot = pcid_lookup(NULL);
+		if (slot == NULL)
+		{
+			slot = &pcid_slots[pcid_victim];
+			pcid_victim = pcid_victim + 1 < PCID_CNT ? pcid_victim + 1 : 1;
+		}
+		slot->pml4 = pml4;
+		slot->stale = true;
+	}
+
+	*flush = slot->stale;
+	slot->stale = false;
+	return slot - pcid_slots;
+}
+
+/* Marks the PCID of PML4 (if any) stale, so the TLB entries tagged
+ * with it are flushed when PML4 is next loaded. */
+static void
+pcid_mark_stale(uint64_t *pml4)
+{
+	if (!pcid_enabled)
+		return;
+
+	enum intr_level old_level = intr_disable();
+	struct pcid_slot *slot = pcid_lookup(pml4);
+	if (slot != NULL)
+		slot->stale = true;
+	intr_set_level(old_level);
+}
+
+/* Invalidates the TLB entry for VPAGE in PML4 after its PTE has
+ * changed.  If PML4 is not the loaded one, its PCID is marked stale
+ * instead. */
+static void
+tlb_invalidate(uint64_t *pml4, const void *vpage)
+{
+	if (PTE_ADDR(rcr3()) == vtop(pml4))
+		invlpg((uint64_t)vpage);
+	else
+		pcid_mark_stale(pml4);
+}
+
+/* Drops every non-global TLB entry of PML4.  Reloading CR3 without
+ * CR3_NOFLUSH flushes the current PCID. */
+static void
+tlb_flush(uint64_t *pml4)
+{
+	uint64_t cr3 = rcr3();
+
+	if (PTE_ADDR(cr3) == vtop(pml4))
+		lcr3(cr3);
+	else
+		pcid_mark_stale(pml4);
+}
+
 /* Loads page directory PD into the CPU's page directory base
  * register. */
 void pml4_activate(uint64_t *pml4)
 {
-	lcr3(vtop(pml4 ? pml4 : base_pml4));
+	if (pml4 == NULL || !pcid_enabled)
+	{
+		lcr3(vtop(pml4 ? pml4 : base_pml4));
+		return;
+	}
+
+	enum intr_level old_level = intr_disable();
+	bool flush;
+	unsigned pcid = pcid_get(pml4, &flush);
+	lcr3(vtop(pml4) | pcid | (flush ? 0 : CR3_NOFLUSH));
+	intr_set_level(old_level);
+}
+
+/* Turns on global pages, so kernel mappings (PTE_G) survive CR3
+ * loads, and PCIDs if the CPU supports them.  Called once from
+ * paging_init() with base_pml4 (PCID 0) loaded. */
+void pml4_tlb_init(void)
+{
+	uint64_t cr4 = rcr4() | CR4_PGE;
+
+	if (cpuid_ecx(1) & CPUID_1_ECX_PCID)
+	{
+		cr4 |= CR4_PCIDE;
+		pcid_enabled = true;
+	}
+	lcr4(cr4);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -260,7 +468,11 @@ pml4_get_page(uint64_t *pml4, const void *uaddr)
 	uint64_t *pte = pml4e_walk(pml4, (uint64_t)uaddr, 0);
 
 	if (pte && (*pte & PTE_P))
+	{
+		if (*pte & PTE_PS)
+			return ptov(PTE_ADDR(*pte) & ~LPGMASK) + ((uint64_t)uaddr & LPGMASK);
 		return ptov(PTE_ADDR(*pte)) + pg_ofs(uaddr);
+	}
 	// pte 참조해서 physical frame 시작 위치 알아낸 후,
 	// user vaddr에서 physical offset (pg_ofs) 뽑아내서 정확한 physical address 뽑아냄
 	return NULL;
@@ -284,7 +496,12 @@ bool pml4_set_page(uint64_t *pml4, void *upage, void *kpage, bool rw)
 	uint64_t *pte = pml4e_walk(pml4, (uint64_t)upage, 1); // address of pte (pte = physical address for physical memory frame)
 
 	if (pte)
+	{
+		bool was_present = (*pte & PTE_P) != 0;
 		*pte = vtop(kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		if (was_present)
+			tlb_invalidate(pml4, upage);
+	}
 	// pte에 kpage가 가리키는 physical frame 위치를 넣어버림
 	return pte != NULL;
 }
@@ -304,11 +521,34 @@ void pml4_clear_page(uint64_t *pml4, void *upage)
 	if (pte != NULL && (*pte & PTE_P) != 0)
 	{
 		*pte &= ~PTE_P;
-		if (rcr3() == vtop(pml4))
-			invlpg((uint64_t)upage);
+		tlb_invalidate(pml4, upage);
 	}
 }
 
+/* Removes every mapping for user virtual pages in [START, END) from
+ * PML4 in a single walk and frees the page tables that become empty.
+ * Unlike pml4_clear_page(), the PTEs are zeroed, and the mapped frames
+ * are not freed.  The TLB is then fixed up with one invlpg per page
+ * for small ranges, or with a single flush for large ones. */
+void pml4_clear_range(uint64_t *pml4, void *start, void *end)
+{
+	ASSERT(pg_ofs(start) == 0);
+	ASSERT(pg_ofs(end) == 0);
+	ASSERT(start <= end);
+	ASSERT(is_user_vaddr(start));
+	ASSERT((uint64_t)end <= KERN_BASE);
+
+	size_t page_cnt = ((uint64_t)end - (uint64_t)start) / PGSIZE;
+	if (clear_range(pml4, 3, 0, (uint64_t)start, (uint64_t)end, false) == 0)
+		return;
+
+	if (page_cnt > INVLPG_MAX)
+		tlb_flush(pml4);
+	else
+		for (void *va = start; va < end; va += PGSIZE)
+			tlb_invalidate(pml4, va);
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PML4 is dirty,
  * that is, if the page has been modified since the PTE was
  * installed.
@@ -329,10 +569,25 @@ void pml4_set_dirty(uint64_t *pml4, const void *vpage, bool dirty)
 		if (dirty)
 			*pte |= PTE_D;
 		else
-			*pte &= ~(uint32_t)PTE_D;
+			*pte &= ~(uint64_t)PTE_D;
+
+		tlb_invalidate(pml4, vpage);
+	}
+}
+
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+ * VPAGE in PML4, keeping the accessed and dirty bits. */
+void pml4_set_writable(uint64_t *pml4, const void *vpage, bool writable)
+{
+	uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+	if (pte)
+	{
+		if (writable)
+			*pte |= PTE_W;
+		else
+			*pte &= ~(uint64_t)PTE_W;
 
-		if (rcr3() == vtop(pml4))
-			invlpg((uint64_t)vpage);
+		tlb_invalidate(pml4, vpage);
 	}
 }
 
@@ -356,9 +611,8 @@ void pml4_set_accessed(uint64_t *pml4, const void *vpage, bool accessed)
 		if (accessed)
 			*pte |= PTE_A;
 		else
-			*pte &= ~(uint32_t)PTE_A;
+			*pte &= ~(uint64_t)PTE_A;
 
-		if (rcr3() == vtop(pml4))
-			invlpg((uint64_t)vpage);
+		tlb_invalidate(pml4, vpage);
 	}
 }
@@ -329,6 +329,21 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_page_cnt (void) {
+	return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the index of PAGE, a page of the user pool, within the
+   pool: a dense frame number for tables indexed by user frame. */
+size_t
+palloc_user_page_idx (void *page) {
+	ASSERT (pg_ofs (page) == 0);
+	ASSERT (page_from_pool (&user_pool, page));
+	return pg_no (page) - pg_no (user_pool.base);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
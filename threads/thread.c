@@ -30,6 +30,7 @@ static struct list ready_list;
 
 /* Project 1 */
 static struct list sleep_list; // 1-1 Alarm clock
+int load_avg; // 1-3 mlfqs, in 17.14 fixed point
 
 // #define DEBUG
 #include "my_debugHelper.c"
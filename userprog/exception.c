@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
@@ -11,6 +12,39 @@ static long long page_fault_cnt;
 
 static void kill(struct intr_frame *);
 static void page_fault(struct intr_frame *);
+static bool search_fixup(struct intr_frame *);
+
+/* Copies SIZE bytes from SRC to DST with a single "rep movsb" and
+   returns the number of bytes left uncopied: 0, unless a fault
+   that demand paging could not resolve stopped the copy, in which
+   case page_fault() resumes it at user_copy_fixup through the
+   fixup table below.  The faulting instruction is restarted after
+   a resolved fault with RCX still counting the bytes left. */
+size_t user_copy(void *dst, const void *src, size_t size);
+extern const char user_copy_insn[], user_copy_fixup[];
+asm(".text\n"
+	".globl user_copy\n"
+	".type user_copy, @function\n"
+	"user_copy:\n"
+	"	movq %rdx, %rcx\n"
+	"user_copy_insn:\n"
+	"	rep movsb\n"
+	"user_copy_fixup:\n"
+	"	movq %rcx, %rax\n"
+	"	ret\n");
+
+/* Exception fixup table: kernel instructions that may fault on
+   user memory, and where to continue if they do and the fault is
+   not one that demand paging resolves. */
+struct exception_fixup
+{
+	const void *insn;	/* Instruction that may fault. */
+	const void *fixup;	/* Where to continue instead. */
+};
+
+static const struct exception_fixup fixup_table[] = {
+	{user_copy_insn, user_copy_fixup},
+};
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -155,6 +189,10 @@ page_fault(struct intr_frame *f)
 	/* Count page faults. */
 	page_fault_cnt++;
 
+	/* A bad user address met by a user copy: make the copy fail. */
+	if (!user && search_fixup(f))
+		return;
+
 	/* If the fault is true fault, show info and exit. */
 /*	
 	printf("Page fault at %p: %s error %s page in %s context.\n",
@@ -166,3 +204,76 @@ page_fault(struct intr_frame *f)
 	//kill(f);
 	exit(-1); // multi-oom and other Project2 test-cases
 }
+
+/* If F is a fault at an instruction in the fixup table, makes it
+   continue at the instruction's fixup and returns true. */
+static bool
+search_fixup(struct intr_frame *f)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof fixup_table / sizeof *fixup_table; i++)
+		if (f->rip == (uintptr_t)fixup_table[i].insn)
+		{
+			f->rip = (uintptr_t)fixup_table[i].fixup;
+			return true;
+		}
+	return false;
+}
+
+/* Returns true if the SIZE bytes at UADDR lie in user space and,
+   if WRITE, none of them is in a page the process may not write.
+   The SPT is consulted once per page; pages it does not know yet
+   may still be stack growth, which is left to the copy's own
+   faults to decide.  A writable page that is mapped read-only,
+   because it shares a frame copy-on-write after fork or through
+   page merging, or is mapped to the zero page, needs nothing here
+   either: CR0.WP makes the copy's first write to it fault, and
+   vm_handle_wp() gives it a frame of its own before the write is
+   retried. */
+static bool
+user_range_ok(const void *uaddr, size_t size, bool write)
+{
+	uintptr_t start = (uintptr_t)uaddr, end = start + size;
+
+	if (uaddr == NULL || !is_user_vaddr(uaddr))
+		return false;
+	if (size == 0)
+		return true;
+	if (end < start || !is_user_vaddr((void *)(end - 1)))
+		return false;
+#ifdef VM
+	if (write)
+	{
+		uintptr_t va;
+
+		for (va = (uintptr_t)pg_round_down(uaddr); va < end; va += PGSIZE)
+		{
+			struct page *page = spt_find_page(&thread_current()->spt,
+											  (void *)va);
+			if (page != NULL && !page->writable)
+				return false;
+		}
+	}
+#endif
+	return true;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address DST.
+   Returns true if successful, false if the source is not all
+   valid user memory, in which case DST may be partly written. */
+bool copy_from_user(void *dst, const void *usrc, size_t size)
+{
+	return user_range_ok(usrc, size, false)
+		&& user_copy(dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address UDST.
+   Returns true if successful, false if the destination is not all
+   valid, writable user memory, in which case it may be partly
+   written. */
+bool copy_to_user(void *udst, const void *src, size_t size)
+{
+	return user_range_ok(udst, size, true)
+		&& user_copy(udst, src, size) == 0;
+}
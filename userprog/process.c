@@ -14,6 +14,7 @@
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
@@ -30,6 +31,12 @@ static void process_cleanup(bool);
 static bool load(const char *file_name, struct intr_frame *if_);
 static void initd(void *f_name);
 static void __do_fork(void *);
+static void __do_spawn(void *);
+static bool prepare_exec(char *file_name, struct intr_frame *_if);
+
+// syscall.c
+void exit(int status);
+void close(int fd);
 
 // Search current thread's child_list and return child with pid. Return NULL if not found.
 struct thread *get_child_with_pid(int pid)
@@ -84,6 +91,8 @@ initd(void *f_name)
 {
 #ifdef VM
 	supplemental_page_table_init(&thread_current()->spt);
+	if (!vm_fault_stats_init())
+		PANIC("Fail to launch initd\n");
 #endif
 
 	if (process_exec(f_name) < 0)
@@ -236,6 +245,12 @@ __do_fork(void *aux)
 	process_activate(current);
 #ifdef VM
 	supplemental_page_table_init(&current->spt);
+	if (!vm_fault_stats_init())
+		goto error;
+	// lazy pages of the executable read the child's own copy of it
+	current->running = file_duplicate(parent->running);
+	if (current->running == NULL)
+		goto error;
 	if (!supplemental_page_table_copy(&current->spt, &parent->spt))
 		goto error;
 #else
@@ -312,24 +327,149 @@ error:
 	exit(TID_ERROR);
 }
 
+// What a child started by process_spawn() gets from its parent.
+// Lives on the parent's stack until the child signals fork_sema.
+struct spawn_args
+{
+	struct thread *parent;
+	char *cmdline;				 // palloc'd page, freed by the child
+	const struct spawn_fd *fds; // parent fds to inherit
+	size_t fd_cnt;
+	bool success;				 // set by the child: loaded?
+};
+
+/* Starts CMDLINE, a palloc'd page that this function takes over, as a
+ * new child process.  Unlike process_fork() followed by exec(), nothing
+ * of the parent's address space or fd table is copied only to be torn
+ * down again: the child loads the executable into an empty address
+ * space and inherits just the console and the FD_CNT fds in FDS.
+ * Returns the child's thread id, or TID_ERROR if it could not be
+ * started. */
+tid_t process_spawn(char *cmdline, const struct spawn_fd *fds, size_t fd_cnt)
+{
+	struct spawn_args args = {thread_current(), cmdline, fds, fd_cnt, false};
+	char name[16];
+	char *prog, *save_ptr;
+
+	// Thread name is the program name, as in process_create_initd()
+	strlcpy(name, cmdline, sizeof name);
+	prog = strtok_r(name, " ", &save_ptr);
+	tid_t tid = prog != NULL ? thread_create(prog, PRI_DEFAULT, __do_spawn, &args)
+							 : TID_ERROR;
+	if (tid == TID_ERROR)
+	{
+		palloc_free_page(cmdline);
+		return TID_ERROR;
+	}
+
+	struct thread *child = get_child_with_pid(tid);
+	sema_down(&child->fork_sema); // wait until child loads
+	if (!args.success)
+	{
+		process_wait(tid); // reap it right away, nobody else will
+		return TID_ERROR;
+	}
+	return tid;
+}
+
+// Gives the current process, a child being spawned, a copy of each of
+// PARENT's fds listed in FDS. Returns false if one is not open.
+static bool
+spawn_install_fds(struct thread *parent, const struct spawn_fd *fds, size_t fd_cnt)
+{
+	struct thread *cur = thread_current();
+
+	for (size_t i = 0; i < fd_cnt; i++)
+	{
+		int pfd = fds[i].parent_fd, cfd = fds[i].child_fd;
+		if (pfd < 0 || pfd >= FDCOUNT_LIMIT || cfd < 0 || cfd >= FDCOUNT_LIMIT)
+			return false;
+		struct file *file = parent->fdTable[pfd];
+		if (file == NULL)
+			return false;
+
+		struct file *new_file = file;
+		if ((uintptr_t)file > 2)
+		{
+			new_file = file_duplicate(file);
+			if (new_file == NULL)
+				return false;
+		}
+		close(cfd); // the console, or an earlier entry, if any
+		if (file == (struct file *)1) // STDIN, see thread_create()
+			cur->stdin_count++;
+		else if (file == (struct file *)2) // STDOUT
+			cur->stdout_count++;
+		cur->fdTable[cfd] = new_file;
+	}
+	return true;
+}
+
+/* A thread function that starts the program of a spawn()'ed child. */
+static void
+__do_spawn(void *aux)
+{
+	struct spawn_args *args = aux;
+	struct thread *current = thread_current();
+	struct intr_frame if_;
+	bool succ = true;
+
+#ifdef VM
+	supplemental_page_table_init(&current->spt);
+	succ = vm_fault_stats_init();
+#endif
+
+	if (succ)
+		succ = spawn_install_fds(args->parent, args->fds, args->fd_cnt);
+	if (succ)
+		succ = prepare_exec(args->cmdline, &if_);
+	else
+		palloc_free_page(args->cmdline);
+
+	args->success = succ;
+	sema_up(&current->fork_sema); // ARGS is gone after this
+	if (!succ)
+		exit(TID_ERROR);
+
+	/* Start the new program. */
+	do_iret(&if_);
+	NOT_REACHED();
+}
+
 /* Switch the current execution context to the f_name.
  * Returns -1 on fail. */
 int process_exec(void *f_name)
 {
-	char *file_name = f_name;
-	bool success;
-	struct thread *cur = thread_current();
-
 	/* We cannot use the intr_frame in the thread structure.
 	 * This is because when current thread rescheduled,
 	 * it stores the execution information to the member. */
 	struct intr_frame _if;
-	_if.ds = _if.es = _if.ss = SEL_UDSEG;
-	_if.cs = SEL_UCSEG;
-	_if.eflags = FLAG_IF | FLAG_MBS;
+
+	if (!prepare_exec(f_name, &_if))
+		return -1;
+
+	/* Start switched process. */
+	do_iret(&_if);
+	NOT_REACHED();
+}
+
+/* Replaces the current address space by the program and arguments in
+ * FILE_NAME, a palloc'd page that is freed, and sets up *_IF to enter
+ * it.  Shared by process_exec() and spawned children. */
+static bool
+prepare_exec(char *file_name, struct intr_frame *_if)
+{
+	bool success;
+
+	_if->ds = _if->es = _if->ss = SEL_UDSEG;
+	_if->cs = SEL_UCSEG;
+	_if->eflags = FLAG_IF | FLAG_MBS;
 
 	/* We first kill the current context */
 	process_cleanup(false); // clear SPT, not destroy
+	// the old image is gone, and with it the reason to deny writes to it
+	file_close(thread_current()->running);
+	thread_current()->running = NULL;
 
 	// Project 2-1. Pass args - parse
 	char *argv[30]; // Q. 테스트는 일단 통과, 사이즈 30이면 충분하겠지? 동적할당 안해도 되겠지?
@@ -345,29 +485,30 @@ int process_exec(void *f_name)
 	}
 
 	/* And then load the binary */
-	success = load(file_name, &_if);
+	success = load(file_name, _if);
 
 	/* If load failed, quit. */
 	if (!success)
 	{
 		palloc_free_page(file_name);
-		return -1;
+		return false;
 	}
 
 	// Project 2-1. Pass args - load arguments onto the user stack
-	void **rspp = &_if.rsp;
+	void **rspp = &_if->rsp;
 	load_userStack(argv, argc, rspp);
-	_if.R.rdi = argc;
-	_if.R.rsi = (uint64_t)*rspp + sizeof(void *);
+	_if->R.rdi = argc;
+	_if->R.rsi = (uint64_t)*rspp + sizeof(void *);
 
-	// hex_dump(_if.rsp, _if.rsp, USER_STACK - (uint64_t)*rspp, true); // #ifdef DEBUG
+	// hex_dump(_if->rsp, _if->rsp, USER_STACK - (uint64_t)*rspp, true); // #ifdef DEBUG
 	// Q. ptr to number? -> convert to int, uint64_t
 
 	palloc_free_page(file_name);
-
-	/* Start switched process. */
-	do_iret(&_if);
-	NOT_REACHED();
+#ifdef VM
+	// Read in what earlier runs faulted in first, or start recording it
+	vm_startup_begin(thread_current()->running);
+#endif
+	return true;
 }
 
 // Load user stack with arguments
@@ -495,6 +636,9 @@ void process_exit(void)
 	file_close(cur->running);
 
 	process_cleanup(true); // destroy SPT
+#ifdef VM
+	vm_fault_stats_exit(); // per-process summary with -fstats
+#endif
 
 	// Wake up blocked parent
 	sema_up(&cur->wait_sema);
@@ -509,12 +653,8 @@ process_cleanup(bool destroySPT)
 	struct thread *curr = thread_current();
 
 #ifdef VM
-	if (destroySPT)
-		supplemental_page_table_kill(&curr->spt);
-		
-		// #ifdef DBG 지금 디자인은 global frame table이라서, parent와 child process가 frame_table을 공유하는데,
-		// child exit 때문에 parent frame이 다 free되는 비효율적인 상황이 나오지 않을까?
-	else
+	vm_startup_end(); // the program is done starting up, one way or another
+	if (!destroySPT)
 		supplemental_page_table_clear(&curr->spt); // save SPT for later (process_exec)
 #endif
 
@@ -533,8 +673,17 @@ process_cleanup(bool destroySPT)
 		 * that's been freed (and cleared). */
 		curr->pml4 = NULL;
 		pml4_activate(NULL);
-		pml4_destroy(pml4);
 	}
+#ifdef VM
+	// On exit the reaper thread frees the pages and the page directory,
+	// so the parent's wait() doesn't have to wait for it (vm_reap)
+	if (destroySPT)
+	{
+		vm_reap(&curr->spt, pml4);
+		return;
+	}
+#endif
+	pml4_destroy(pml4);
 }
 
 /* Sets up the CPU for running user code in the nest thread.
@@ -897,14 +1046,9 @@ lazy_load_segment(struct page *page, void *aux)
 	ASSERT (page->frame != NULL); 	//이 상황에서 page->frame이 제대로 설정돼있는가?
 	void * kva = page->frame->kva;
 	if (file_read(file, kva, page_read_bytes) != (int)page_read_bytes)
-	{
-		//palloc_free_page(page); // #ifdef DBG Q. 여기서 free해주는거 맞아?
-		free(lazy_load_info);
 		return false;
-	}
 
 	memset(kva + page_read_bytes, 0, page_zero_bytes);
-	free(lazy_load_info);
 	return true;
 }
 
@@ -940,13 +1084,17 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		struct lazy_load_info *lazy_load_info = malloc(sizeof(struct lazy_load_info));
-		lazy_load_info->file = file;
-		lazy_load_info->page_read_bytes = page_read_bytes;
-		lazy_load_info->page_zero_bytes = page_zero_bytes;
-		lazy_load_info->offset = ofs;
-		void *aux = lazy_load_info;
-		if (!vm_alloc_page_with_initializer(VM_ANON, upage,
+		// copied into the page, so it can live on our stack
+		struct lazy_load_info lazy_load_info = {
+			.file = file,
+			.page_read_bytes = page_read_bytes,
+			.page_zero_bytes = page_zero_bytes,
+			.offset = ofs,
+		};
+		void *aux = &lazy_load_info;
+		// read-only segments are shared with other instances of the program
+		enum vm_type type = writable ? VM_ANON : VM_FILE | VM_TEXT;
+		if (!vm_alloc_page_with_initializer(type, upage,
 											writable, lazy_load_segment, aux))
 			return false;
 
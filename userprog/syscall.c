@@ -4,6 +4,7 @@
 #include "threads/palloc.h"
 #include "threads/flags.h"
 #include "threads/vaddr.h"
+#include "userprog/exception.h"
 #include "userprog/gdt.h"
 #include "userprog/process.h"
 #include "userprog/syscall.h"
@@ -20,6 +21,7 @@ void syscall_handler(struct intr_frame *);
 
 // Project2-4 File descriptor
 static struct file *find_file_by_fd(int fd);
+struct lock file_rw_lock;
 // Project2-extra
 const int STDIN = 1;
 const int STDOUT = 2;
@@ -37,8 +39,16 @@ void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close(int fd);
 int dup2(int oldfd, int newfd);
+tid_t spawn(const char *cmdline, const struct spawn_fd *fds);
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+void faultstat (struct fault_stats *stats, bool all);
+int madvise (void *addr, size_t length, int advice);
+int msync (void *addr, size_t length);
+size_t workingset (void);
+int mlock (void *addr, size_t length);
+int munlock (void *addr, size_t length);
+int mlockall (void);
 // #define DEBUG
 
 /* System call.
@@ -110,11 +120,9 @@ void syscall_handler(struct intr_frame *f)
 		f->R.rax = filesize(f->R.rdi);
 		break;
 	case SYS_READ:
-		check_valid_buffer(f->R.rsi, f->R.rdx, f->rsp, 1);
 		f->R.rax = read(f->R.rdi, f->R.rsi, f->R.rdx);
 		break;
 	case SYS_WRITE:
-		check_valid_buffer(f->R.rsi, f->R.rdx, f->rsp, 0);
 		f->R.rax = write(f->R.rdi, f->R.rsi, f->R.rdx);
 		break;
 	case SYS_SEEK:
@@ -135,6 +143,30 @@ void syscall_handler(struct intr_frame *f)
 	case SYS_MUNMAP:
 		munmap(f->R.rdi);
 		break;
+	case SYS_FAULTSTAT:
+		faultstat((struct fault_stats *)f->R.rdi, f->R.rsi);
+		break;
+	case SYS_MADVISE:
+		f->R.rax = madvise((void *)f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_MSYNC:
+		f->R.rax = msync((void *)f->R.rdi, f->R.rsi);
+		break;
+	case SYS_WORKINGSET:
+		f->R.rax = workingset();
+		break;
+	case SYS_SPAWN:
+		f->R.rax = spawn((const char *)f->R.rdi, (const struct spawn_fd *)f->R.rsi);
+		break;
+	case SYS_MLOCK:
+		f->R.rax = mlock((void *)f->R.rdi, f->R.rsi);
+		break;
+	case SYS_MUNLOCK:
+		f->R.rax = munlock((void *)f->R.rdi, f->R.rsi);
+		break;
+	case SYS_MLOCKALL:
+		f->R.rax = mlockall();
+		break;
 	default:
 		exit(-1);
 		break;
@@ -191,17 +223,9 @@ struct page * check_address(void *addr) {
     return spt_find_page(&thread_current()->spt, addr);
 }
 
-void check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write) {
-    for (int i = 0; i < size; i++) {
-        struct page* page = check_address(buffer + i);    // 인자로 받은 buffer부터 buffer + size까지의 크기가 한 페이지의 크기를 넘을수도 있음
-        if(page == NULL)
-            exit(-1);
-        if(to_write == true && page->writable == false)
-            exit(-1);
-    }
-}
-
-//beffer 의 끝까지 address를 체크해주어야한다.
+// User buffers are not checked byte by byte: read() and write() go through a
+// kernel page with copy_to_user()/copy_from_user(), which check each user
+// page once and fail on a bad address instead of faulting (exception.c).
 
 // Project 2-4. File descriptor
 // Check if given fd is valid, return cur->fdTable[fd]
@@ -306,6 +330,91 @@ int filesize(int fd)
 	return file_length(fileobj);
 }
 
+// Reads size bytes from file into user buffer, a page at a time through a
+// kernel page, or straight into the buffer's frame where it is mlocked.
+// Exits the process if buffer turns out to be bad.
+static int read_file(struct file *file, void *buffer, unsigned size)
+{
+	uint8_t *kbuf = palloc_get_page(0);
+	unsigned done = 0;
+
+	if (kbuf == NULL)
+		return -1;
+	lock_acquire(&file_rw_lock);
+	while (done < size)
+	{
+		unsigned chunk = size - done < PGSIZE ? size - done : PGSIZE;
+		uint8_t *kdst = vm_mlocked_kva(buffer + done, true);
+
+		// in place only up to the end of the locked page
+		if (kdst != NULL && chunk > PGSIZE - pg_ofs(buffer + done))
+			chunk = PGSIZE - pg_ofs(buffer + done);
+		int n = file_read(file, kdst != NULL ? kdst : kbuf, chunk);
+
+		if (n <= 0)
+			break;
+		if (kdst == NULL && !copy_to_user(buffer + done, kbuf, n))
+		{
+			lock_release(&file_rw_lock);
+			palloc_free_page(kbuf);
+			exit(-1);
+		}
+		done += n;
+		if ((unsigned)n < chunk)
+			break;
+	}
+	lock_release(&file_rw_lock);
+	palloc_free_page(kbuf);
+	return done;
+}
+
+// Writes size bytes from user buffer to file, or to the console if file is
+// NULL, a page at a time through a kernel page, or straight from the
+// buffer's frame where it is mlocked. Exits the process if buffer turns out
+// to be bad.
+static int write_file(struct file *file, const void *buffer, unsigned size)
+{
+	uint8_t *kbuf = palloc_get_page(0);
+	unsigned done = 0;
+
+	if (kbuf == NULL)
+		return -1;
+	if (file != NULL)
+		lock_acquire(&file_rw_lock);
+	while (done < size)
+	{
+		unsigned chunk = size - done < PGSIZE ? size - done : PGSIZE;
+		const uint8_t *ksrc = vm_mlocked_kva(buffer + done, false);
+		int n;
+
+		if (ksrc != NULL && chunk > PGSIZE - pg_ofs(buffer + done))
+			chunk = PGSIZE - pg_ofs(buffer + done);
+		else if (ksrc == NULL)
+		{
+			if (!copy_from_user(kbuf, buffer + done, chunk))
+			{
+				if (file != NULL)
+					lock_release(&file_rw_lock);
+				palloc_free_page(kbuf);
+				exit(-1);
+			}
+			ksrc = kbuf;
+		}
+		n = chunk;
+		if (file == NULL)
+			putbuf((const char *)ksrc, chunk);
+		else if ((n = vm_file_write(file, ksrc, chunk)) <= 0)
+			break;
+		done += n;
+		if ((unsigned)n < chunk)
+			break;
+	}
+	if (file != NULL)
+		lock_release(&file_rw_lock);
+	palloc_free_page(kbuf);
+	return done;
+}
+
 // Reads size bytes from the file open as fd into buffer.
 // Returns the number of bytes actually read (0 at end of file), or -1 if the file could not be read
 int read(int fd, void *buffer, unsigned size)
@@ -314,16 +423,6 @@ int read(int fd, void *buffer, unsigned size)
 	int ret;
 	struct thread *cur = thread_current();
 
-	#ifdef VM
-
-	int page_fault_trigger = ((int *)buffer)[1]; //pt_grow_stk_sc - arouse page fault before searching in spt.
-	struct supplemental_page_table *spt = &cur->spt;
-	struct page * page = spt_find_page (spt, buffer);
-	if (page->operations->type == VM_ANON && !(page->writable)){
-		exit(-1);
-	}
-	#endif
-
 	struct file *fileobj = find_file_by_fd(fd);
 	if (fileobj == NULL)
 		return -1;
@@ -344,7 +443,8 @@ int read(int fd, void *buffer, unsigned size)
 			for (i = 0; i < size; i++)
 			{
 				char c = input_getc();
-				*buf++ = c;
+				if (!copy_to_user(buf++, &c, 1))
+					exit(-1);
 				if (c == '\0')
 					break;
 			}
@@ -360,9 +460,7 @@ int read(int fd, void *buffer, unsigned size)
 		// Q. read는 동시접근 허용해도 되지 않을까?
 		// > 아마 write와의 mutual_exclusion 위해서 같은 rw_lock 쓰는 듯
 		// readers-writer problem 참고
-		lock_acquire(&file_rw_lock);
-		ret = file_read(fileobj, buffer, size);
-		lock_release(&file_rw_lock);
+		ret = read_file(fileobj, buffer, size);
 	}
 	return ret;
 }
@@ -391,8 +489,7 @@ int write(int fd, const void *buffer, unsigned size)
 		}
 		else
 		{
-			putbuf(buffer, size);
-			ret = size;
+			ret = write_file(NULL, buffer, size);
 		}
 	}
 	else if (fileobj == STDIN)
@@ -401,9 +498,7 @@ int write(int fd, const void *buffer, unsigned size)
 	}
 	else
 	{
-		lock_acquire(&file_rw_lock);
-		ret = file_write(fileobj, buffer, size);
-		lock_release(&file_rw_lock);
+		ret = write_file(fileobj, buffer, size);
 	}
 
 	return ret;
@@ -519,6 +614,36 @@ int exec(char *file_name)
 	return 0;
 }
 
+// Runs cmdline in a new child process, like fork() then exec() but without
+// copying this process first. The child has the console as fds 0 and 1 and
+// the fds listed in 'fds', if any (see <spawn.h>). Returns the child's pid,
+// or -1 if it could not be started.
+tid_t spawn(const char *cmdline, const struct spawn_fd *fds)
+{
+	struct spawn_fd kfds[SPAWN_FD_MAX];
+	size_t cnt = 0;
+
+	check_address((void *)cmdline);
+	while (fds != NULL)
+	{
+		struct spawn_fd entry;
+		if (!copy_from_user(&entry, &fds[cnt], sizeof entry))
+			exit(-1);
+		if (entry.parent_fd == SPAWN_FD_END)
+			break;
+		if (cnt == SPAWN_FD_MAX)
+			return -1;
+		kfds[cnt++] = entry;
+	}
+
+	// copied, like exec(): the child parses it with its own address space active
+	char *fn_copy = palloc_get_page(0);
+	if (fn_copy == NULL)
+		return -1;
+	strlcpy(fn_copy, cmdline, PGSIZE);
+	return process_spawn(fn_copy, kfds, cnt);
+}
+
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset){
 	//void *page_addr = addr;
 	if(length == 0 || addr == 0 || offset > PGSIZE)// || pg_ofs(addr) != 0)
@@ -541,4 +666,36 @@ void *mmap (void *addr, size_t length, int writable, int fd, off_t offset){
 // Project 3-3 mmap
 void munmap (void *addr){
 	do_munmap(addr);
-}
\ No newline at end of file
+}
+// Page fault statistics of this process, or of the system if 'all'
+void faultstat (struct fault_stats *stats, bool all){
+	struct fault_stats s;
+
+	vm_fault_stats(&s, all);
+	if (!copy_to_user(stats, &s, sizeof s))
+		exit(-1);
+}
+// Usage hint for [addr, addr + length); checked against the SPT by vm_madvise
+int madvise (void *addr, size_t length, int advice){
+	return vm_madvise(addr, length, advice);
+}
+// Write the dirty pages of mappings in [addr, addr + length) back now
+int msync (void *addr, size_t length){
+	return vm_msync(addr, length);
+}
+// Pages of this process used recently, as sampled by the aging thread
+size_t workingset (void){
+	return vm_working_set();
+}
+// Fault [addr, addr + length) in and keep it from being evicted; see vm_mlock
+int mlock (void *addr, size_t length){
+	return vm_mlock(addr, length);
+}
+// Let [addr, addr + length) be evicted again
+int munlock (void *addr, size_t length){
+	return vm_munlock(addr, length);
+}
+// Lock every page this process has now
+int mlockall (void){
+	return vm_mlockall();
+}
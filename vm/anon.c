@@ -2,6 +2,13 @@
 
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include <bitmap.h>
+#include <lz.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk; // #ifdef DBG Q. 이게 뭐임?
@@ -19,11 +26,108 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* A swap slot holds one page. */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Pages gathered before they are written out as one run. */
+#define SWAP_CLUSTER 8
+
+/* Swap table: one bit per slot of swap_disk, true if in use. */
+static struct bitmap *swap_table;
+static size_t swap_cursor;              /* Where the next slot search starts. */
+static struct lock swap_lock;           /* Protects all of the swap state. */
+
+/* Write-behind cluster.  Evicted pages are copied into
+ * cluster_buf in adjacent slots [cluster_start, cluster_start +
+ * cluster_cnt) and written with one disk command once the run is
+ * full or broken, so an eviction storm turns into a few long
+ * sequential writes instead of one command per sector. */
+static uint8_t *cluster_buf;            /* SWAP_CLUSTER pages. */
+static size_t cluster_start;
+static size_t cluster_cnt;
+
+static void cluster_flush (void);
+
+/* Compressed swap cache.  A page being swapped out still gets a
+ * swap slot, but is compressed and kept in RAM, in pool pages taken
+ * from the kernel pool, instead of being written to swap_disk, so
+ * that swapping it back in costs a decompression rather than disk
+ * reads.  Only when the pool would grow past zswap_max_pages are
+ * the coldest entries written to their slots on disk.  Pages that
+ * do not compress to ZSWAP_MAX_SIZE go to disk directly.
+ *
+ * The pool allocator pairs entries as in zbud: a pool page holds
+ * up to two, one at each end.  Pool pages with a single entry are
+ * kept in unbuddied[], by free space in ZSWAP_CHUNK-byte chunks,
+ * so a new entry can be paired in constant time.  Entries are
+ * found by slot through zswap_index.  Protected by swap_lock. */
+#define ZSWAP_CHUNK 64
+#define ZSWAP_CHUNKS (PGSIZE / ZSWAP_CHUNK)
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4)
+size_t zswap_max_pages = 128;
+
+/* A pool page. */
+struct zpage {
+	uint8_t *kva;
+	struct zswap_entry *first;      /* Entry at the start, or null. */
+	struct zswap_entry *last;       /* Entry at the end, or null. */
+	struct list_elem elem;          /* In unbuddied[] if one is null. */
+};
+
+/* A compressed page. */
+struct zswap_entry {
+	size_t slot;                    /* Swap slot it stands for. */
+	struct zpage *zpage;
+	size_t len;                     /* Compressed size. */
+	struct hash_elem hash_elem;     /* In zswap_index. */
+	struct list_elem lru_elem;      /* In zswap_lru, oldest first. */
+};
+
+static struct list unbuddied[ZSWAP_CHUNKS];
+static struct ohash zswap_index;
+static struct list zswap_lru;
+static size_t zswap_page_cnt;           /* Pool pages in use. */
+static uint8_t *zswap_buf;              /* Two pages: output, then input. */
+static void *zswap_work;                /* lz_compress() scratch space. */
+
+static hash_hash_func zswap_hash;
+static hash_less_func zswap_less;
+
+/* Statistics. */
+static long long zswap_store_cnt;       /* Pages stored compressed. */
+static long long zswap_store_bytes;     /* Their compressed size. */
+static long long zswap_reject_cnt;      /* Pages that went to disk instead. */
+static long long zswap_writeback_cnt;   /* Entries written back to disk. */
+static long long zswap_hit_cnt;         /* Loads served from the pool. */
+static long long zswap_miss_cnt;        /* Loads served from disk. */
+static size_t zswap_peak_cnt;           /* Most pool pages in use. */
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
+	size_t i;
+
 	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	swap_disk = disk_get (1, 1);
+	lock_init (&swap_lock);
+	if (swap_disk == NULL)
+		return;
+
+	swap_table = bitmap_create (disk_size (swap_disk) / SECTORS_PER_SLOT);
+	cluster_buf = palloc_get_multiple (0, SWAP_CLUSTER);
+	if (swap_table == NULL || cluster_buf == NULL)
+		PANIC ("swap: out of memory");
+	swap_cursor = 0;
+	cluster_cnt = 0;
+
+	for (i = 0; i < ZSWAP_CHUNKS; i++)
+		list_init (&unbuddied[i]);
+	ohash_init (&zswap_index, zswap_hash, zswap_less, NULL);
+	list_init (&zswap_lru);
+	zswap_buf = palloc_get_multiple (0, 2);
+	zswap_work = malloc (LZ_WORK_SIZE);
+	if (zswap_buf == NULL || zswap_work == NULL)
+		zswap_max_pages = 0;
 }
 
 /* Initialize the file mapping */
@@ -33,22 +137,330 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->swap_slot = BITMAP_ERROR;
+	return true;
+}
+
+/* Writes the pending cluster to swap_disk.  Must be called with
+ * swap_lock held. */
+static void
+cluster_flush (void) {
+	if (cluster_cnt == 0)
+		return;
+	disk_write_multiple (swap_disk, cluster_start * SECTORS_PER_SLOT,
+			cluster_buf, cluster_cnt * SECTORS_PER_SLOT);
+	cluster_cnt = 0;
+}
+
+/* Writes the page at KVA to swap slot SLOT through the
+ * write-behind cluster.  Must be called with swap_lock held. */
+static void
+write_slot (size_t slot, const void *kva) {
+	if (cluster_cnt > 0 && slot != cluster_start + cluster_cnt)
+		cluster_flush ();
+	if (cluster_cnt == 0)
+		cluster_start = slot;
+	memcpy (cluster_buf + cluster_cnt * PGSIZE, kva, PGSIZE);
+	if (++cluster_cnt == SWAP_CLUSTER)
+		cluster_flush ();
+}
+
+/* Hash and comparison functions for zswap_index. */
+static uint64_t
+zswap_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct zswap_entry *z = hash_entry (e, struct zswap_entry, hash_elem);
+	return hash_int (z->slot);
+}
+
+static bool
+zswap_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct zswap_entry, hash_elem)->slot
+		< hash_entry (b, struct zswap_entry, hash_elem)->slot;
+}
+
+/* Returns the pool entry for SLOT, or a null pointer if it is not
+ * in the pool.  Must be called with swap_lock held. */
+static struct zswap_entry *
+zswap_find (size_t slot) {
+	struct zswap_entry key;
+	struct hash_elem *e;
+
+	key.slot = slot;
+	e = ohash_find (&zswap_index, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct zswap_entry, hash_elem) : NULL;
+}
+
+/* Returns where the data of entry Z lies. */
+static uint8_t *
+zswap_data (struct zswap_entry *z) {
+	struct zpage *zp = z->zpage;
+	return zp->first == z ? zp->kva : zp->kva + PGSIZE - z->len;
+}
+
+/* Chunks an entry of LEN bytes takes up. */
+static size_t
+zswap_chunks (size_t len) {
+	return DIV_ROUND_UP (len, ZSWAP_CHUNK);
+}
+
+/* Files ZP, which holds one entry, in unbuddied[] by its free
+ * space. */
+static void
+zswap_unbuddied_add (struct zpage *zp) {
+	struct zswap_entry *z = zp->first != NULL ? zp->first : zp->last;
+	list_push_back (&unbuddied[ZSWAP_CHUNKS - zswap_chunks (z->len)],
+			&zp->elem);
+}
+
+/* Returns a pool page with room for LEN bytes that holds one entry,
+ * taking it out of unbuddied[], or a null pointer if there is
+ * none. */
+static struct zpage *
+zswap_find_room (size_t len) {
+	size_t i;
+
+	for (i = zswap_chunks (len); i < ZSWAP_CHUNKS; i++)
+		if (!list_empty (&unbuddied[i]))
+			return list_entry (list_pop_front (&unbuddied[i]), struct zpage,
+					elem);
+	return NULL;
+}
+
+/* Removes entry Z from the pool and frees it.  Must be called
+ * with swap_lock held. */
+static void
+zswap_remove (struct zswap_entry *z) {
+	struct zpage *zp = z->zpage;
+
+	ohash_delete (&zswap_index, &z->hash_elem);
+	list_remove (&z->lru_elem);
+	if (zp->first != NULL && zp->last != NULL) {
+		if (zp->first == z)
+			zp->first = NULL;
+		else
+			zp->last = NULL;
+		zswap_unbuddied_add (zp);
+	} else {
+		list_remove (&zp->elem);
+		palloc_free_page (zp->kva);
+		free (zp);
+		zswap_page_cnt--;
+	}
+	free (z);
+}
+
+/* Writes the oldest entry in the pool to its slot on disk and
+ * removes it.  Must be called with swap_lock held. */
+static void
+zswap_writeback (void) {
+	struct zswap_entry *z = list_entry (list_front (&zswap_lru),
+			struct zswap_entry, lru_elem);
+	uint8_t *page = zswap_buf + PGSIZE;
+
+	if (!lz_decompress (zswap_data (z), z->len, page, PGSIZE))
+		PANIC ("zswap: corrupt entry for slot %zu", z->slot);
+	write_slot (z->slot, page);
+	zswap_remove (z);
+	zswap_writeback_cnt++;
+}
+
+/* Tries to keep the page at KVA, for swap slot SLOT, compressed in
+ * the pool, making room by writing the oldest entries back if the
+ * pool is full.  Returns false if the page is not worth keeping or
+ * there is no room.  Must be called with swap_lock held. */
+static bool
+zswap_store (size_t slot, const void *kva) {
+	struct zswap_entry *z;
+	struct zpage *zp;
+	size_t len;
+
+	if (zswap_max_pages == 0)
+		return false;
+	len = lz_compress (kva, PGSIZE, zswap_buf, ZSWAP_MAX_SIZE, zswap_work);
+	if (len == 0)
+		return false;
+
+	while ((zp = zswap_find_room (len)) == NULL
+			&& zswap_page_cnt >= zswap_max_pages && !list_empty (&zswap_lru))
+		zswap_writeback ();
+	z = malloc (sizeof *z);
+	if (z == NULL)
+		goto no_room;
+	if (zp == NULL) {
+		if (zswap_page_cnt >= zswap_max_pages
+				|| (zp = malloc (sizeof *zp)) == NULL)
+			goto no_room;
+		zp->kva = palloc_get_page (0);
+		if (zp->kva == NULL) {
+			free (zp);
+			zp = NULL;
+			goto no_room;
+		}
+		zp->first = zp->last = NULL;
+		if (++zswap_page_cnt > zswap_peak_cnt)
+			zswap_peak_cnt = zswap_page_cnt;
+	}
+
+	z->slot = slot;
+	z->zpage = zp;
+	z->len = len;
+	if (zp->first == NULL)
+		zp->first = z;
+	else
+		zp->last = z;
+	memcpy (zswap_data (z), zswap_buf, len);
+	if (zp->first == NULL || zp->last == NULL)
+		zswap_unbuddied_add (zp);
+	ohash_insert (&zswap_index, &z->hash_elem);
+	list_push_back (&zswap_lru, &z->lru_elem);
+	zswap_store_cnt++;
+	zswap_store_bytes += len;
+	return true;
+
+no_room:
+	if (zp != NULL)
+		zswap_unbuddied_add (zp);
+	free (z);
+	return false;
+}
+
+/* Returns true if SLOT is waiting in the write-behind cluster.
+ * Must be called with swap_lock held. */
+static bool
+in_cluster (size_t slot) {
+	return cluster_cnt > 0
+		&& slot >= cluster_start && slot < cluster_start + cluster_cnt;
+}
+
+/* Reads swap slot SLOT into KVA, from the compressed pool or the
+ * pending cluster if it has not reached the disk yet.  Must be
+ * called with swap_lock held. */
+static void
+read_slot (size_t slot, void *kva) {
+	struct zswap_entry *z = zswap_find (slot);
+
+	if (z != NULL) {
+		if (!lz_decompress (zswap_data (z), z->len, kva, PGSIZE))
+			PANIC ("zswap: corrupt entry for slot %zu", slot);
+		zswap_hit_cnt++;
+		return;
+	}
+	zswap_miss_cnt++;
+	if (in_cluster (slot))
+		memcpy (kva, cluster_buf + (slot - cluster_start) * PGSIZE, PGSIZE);
+	else
+		disk_read_multiple (swap_disk, slot * SECTORS_PER_SLOT, kva,
+				SECTORS_PER_SLOT);
+}
+
+/* Frees swap slot SLOT and its pool entry, if any.  Must be called
+ * with swap_lock held. */
+static void
+free_slot (size_t slot) {
+	struct zswap_entry *z = zswap_find (slot);
+
+	if (z != NULL)
+		zswap_remove (z);
+	bitmap_reset (swap_table, slot);
 }
 
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+	size_t slot = anon_page->swap_slot;
+
+	/* No slot: the page was mapped to the shared zero page. */
+	if (slot == BITMAP_ERROR) {
+		memset (kva, 0, PGSIZE);
+		return true;
+	}
+
+	lock_acquire (&swap_lock);
+	read_slot (slot, kva);
+	free_slot (slot);
+	lock_release (&swap_lock);
+	anon_page->swap_slot = BITMAP_ERROR;
+	return true;
 }
 
 /* Swap out the page by writing contents to the swap disk. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	size_t slot;
+
+	if (swap_disk == NULL)
+		return false;
+
+	lock_acquire (&swap_lock);
+
+	/* Slots are handed out from a moving cursor, so consecutive
+	 * evictions get adjacent slots and extend the current cluster. */
+	slot = bitmap_scan_and_flip (swap_table, swap_cursor, 1, false);
+	if (slot == BITMAP_ERROR)
+		slot = bitmap_scan_and_flip (swap_table, 0, 1, false);
+	if (slot == BITMAP_ERROR) {
+		lock_release (&swap_lock);
+		return false;
+	}
+	swap_cursor = slot + 1;
+
+	if (!zswap_store (slot, page->frame->kva)) {
+		write_slot (slot, page->frame->kva);
+		zswap_reject_cnt++;
+	}
+
+	lock_release (&swap_lock);
+	anon_page->swap_slot = slot;
+	return true;
+}
+
+/* Copies the contents of PAGE, which is swapped out, into KVA
+ * and leaves it swapped out.  Used by fork to duplicate a page
+ * without faulting it back in for the parent. */
+void
+anon_swap_copy (struct page *page, void *kva) {
+	ASSERT (page->anon.swap_slot != BITMAP_ERROR);
+
+	lock_acquire (&swap_lock);
+	read_slot (page->anon.swap_slot, kva);
+	lock_release (&swap_lock);
+}
+
+/* Throws away the contents of PAGE, which has no frame, so that
+ * it reads back as zeros. */
+void
+anon_discard (struct page *page) {
+	anon_destroy (page);
+	page->anon.swap_slot = BITMAP_ERROR;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->swap_slot != BITMAP_ERROR) {
+		lock_acquire (&swap_lock);
+		free_slot (anon_page->swap_slot);
+		lock_release (&swap_lock);
+	}
+}
+
+/* Prints compressed swap cache statistics. */
+void
+anon_print_stats (void) {
+	long long ratio = zswap_store_bytes
+		? zswap_store_cnt * PGSIZE * 100 / zswap_store_bytes : 0;
+	long long loads = zswap_hit_cnt + zswap_miss_cnt;
+	long long hit_rate = loads ? zswap_hit_cnt * 1000 / loads : 0;
+
+	printf ("Compressed swap: %lld pages stored, %lld.%02lld:1 ratio, "
+			"%lld to disk, %lld written back, %zu pool pages peak\n",
+			zswap_store_cnt, ratio / 100, ratio % 100, zswap_reject_cnt,
+			zswap_writeback_cnt, zswap_peak_cnt);
+	printf ("Compressed swap: %lld of %lld loads hit, %lld.%lld%%\n",
+			zswap_hit_cnt, loads, hit_rate / 10, hit_rate % 10);
 }
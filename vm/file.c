@@ -1,11 +1,17 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
+#include <string.h>
 #include "vm/vm.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
 static void file_backed_destroy (struct page *page);
+static bool text_swap_in (struct page *page, void *kva);
+static bool text_swap_out (struct page *page);
+static void text_destroy (struct page *page);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations file_ops = {
@@ -15,6 +21,16 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+/* Read-only text of an executable.  It is never dirty, so eviction
+ * just drops it, and it reads back through the program's inode
+ * rather than through any one process's open file. */
+static const struct page_operations text_ops = {
+	.swap_in = text_swap_in,
+	.swap_out = text_swap_out,
+	.destroy = text_destroy,
+	.type = VM_FILE | VM_TEXT,
+};
+
 /* The initializer of file vm */
 void
 vm_file_init (void) {
@@ -24,34 +40,53 @@ vm_file_init (void) {
 /* Initialize the file backed page */
 bool
 file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
-	struct uninit_page *uninit = &page->uninit;
-	// vm_initializer *init = uninit->init;
-	void *aux = uninit->aux;
+	/* Copy first: the file page overlays the info in the union. */
+	struct lazy_load_info info = page->uninit.lazy;
 
 	/* Set up the handler */
-	page->operations = &file_ops;
+	page->operations = type & VM_TEXT ? &text_ops : &file_ops;
 
-	struct lazy_load_info *info = (struct lazy_load_info *)aux;
 	struct file_page *file_page = &page->file;
-	file_page->file = info->file;
-	file_page->length = info->page_read_bytes;
-	file_page->offset = info->offset;
+	file_page->file = info.file;
+	file_page->length = info.page_read_bytes;
+	file_page->offset = info.offset;
+	file_page->inode = NULL;
+	if (type & VM_TEXT) {
+		file_page->file = NULL;
+		file_page->inode = inode_reopen (file_get_inode (info.file));
+	}
 
 	//file page 초기화 
 	// file, length, offset 
 	//uninit page를 file-backed 로 초기화 
+	return true;
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+
+	if (file_read_at (file_page->file, kva, file_page->length,
+				file_page->offset) != (off_t) file_page->length)
+		return false;
+	memset (kva + file_page->length, 0, PGSIZE - file_page->length);
+	return true;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.
+ * Clean pages are just dropped; they read back from the file. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	struct frame *frame = page->frame;
+
+	if (pml4_is_dirty (page->pml4, page->va)) {
+		file_write_at (file_page->file, frame->kva, file_page->length,
+				file_page->offset);
+		pml4_set_dirty (page->pml4, page->va, false);
+	}
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
@@ -60,6 +95,37 @@ file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
 }
 
+/* Reads a page of text back from the executable. */
+static bool
+text_swap_in (struct page *page, void *kva) {
+	struct file_page *file_page = &page->file;
+
+	if (inode_read_at (file_page->inode, kva, file_page->length,
+				file_page->offset) != (off_t) file_page->length)
+		return false;
+	memset (kva + file_page->length, 0, PGSIZE - file_page->length);
+	return true;
+}
+
+/* Text is read-only, so there is nothing to save. */
+static bool
+text_swap_out (struct page *page UNUSED) {
+	return true;
+}
+
+static void
+text_destroy (struct page *page) {
+	inode_close (page->file.inode);
+}
+
+/* Returns true if PAGE is executable text, loaded or not. */
+bool
+page_is_text (struct page *page) {
+	if (VM_TYPE (page->operations->type) == VM_UNINIT)
+		return page->uninit.type & VM_TEXT;
+	return page->operations->type & VM_TEXT;
+}
+
 static bool
 lazy_load_segment(struct page *page, void *aux)
 {
@@ -79,12 +145,8 @@ lazy_load_segment(struct page *page, void *aux)
 	//얘는 유저 프로세스와 관련 없고 전체 운영체제에 매핑되어야 할 것 같긴함 (근거 없음)
 
 	if (file_read(file, kva, page_read_bytes) != (int)page_read_bytes)
-	{
-		free(container);
 		return false;
-	}
 	memset(kva + page_read_bytes, 0, page_zero_bytes);
-	free(container);
 
 	file_seek(file, offset);
 	return true; 
@@ -95,8 +157,20 @@ lazy_load_segment(struct page *page, void *aux)
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct mmap_region *region = malloc (sizeof *region);
 	struct file *mfile = file_reopen(file);
 
+	if (region == NULL || mfile == NULL) {
+		free (region);
+		file_close (mfile);
+		return NULL;
+	}
+	region->addr = addr;
+	region->file = mfile;
+	inode_map (file_get_inode (mfile));
+	list_push_back (&spt->mmaps, &region->elem);
+
 	//page = spt_find_page(&thread_current()->spt, addr);
 	void *ori_addr = addr;
 	size_t read_bytes = length > file_length(file) ? file_length(file) : length;
@@ -107,53 +181,143 @@ do_mmap (void *addr, size_t length, int writable,
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-		struct lazy_load_info *container = malloc(sizeof(struct lazy_load_info));
-		container->file = mfile;
-		container->page_read_bytes = page_read_bytes;
-		container->page_zero_bytes = 0;
-		container->offset = offset;
+		struct lazy_load_info container = {
+			.file = mfile,
+			.page_read_bytes = page_read_bytes,
+			.page_zero_bytes = 0,
+			.offset = offset,
+		};
 
-		if (!vm_alloc_page_with_initializer(VM_FILE, addr, writable, lazy_load_segment, container))
+		/* Drops the pages made so far along with the region. */
+		if (!vm_alloc_page_with_initializer(VM_FILE, addr, writable, lazy_load_segment, &container)) {
+			do_munmap (ori_addr);
 			return NULL;
+		}
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
 		addr	   += PGSIZE;
 		offset	   += page_read_bytes;
-			//여기서 NULL 대신 이전까지의 page를 destroy 해야하나?
 	}
 	return ori_addr;
 }
-		
 
-	
-	
+/* Closes the file of REGION, which is off its SPT's list, and
+ * frees it. */
+static void
+mmap_region_close (struct mmap_region *region) {
+	inode_unmap (file_get_inode (region->file));
+	file_close (region->file);
+	free (region);
+}
+
+/* Returns the mapping of SPT that starts at ADDR, or a null
+ * pointer if there is none. */
+static struct mmap_region *
+mmap_find (struct supplemental_page_table *spt, void *addr) {
+	struct list_elem *e;
+
+	for (e = list_begin (&spt->mmaps); e != list_end (&spt->mmaps);
+			e = list_next (e)) {
+		struct mmap_region *region = list_entry (e, struct mmap_region, elem);
+		if (region->addr == addr)
+			return region;
+	}
+	return NULL;
+}
+
+/* Closes the files of the mappings left in SPT, whose pages are
+ * already gone or no longer read, and forgets the mappings. */
+void
+mmap_close_all (struct supplemental_page_table *spt) {
+	while (!list_empty (&spt->mmaps)) {
+		struct list_elem *e = list_pop_front (&spt->mmaps);
+		mmap_region_close (list_entry (e, struct mmap_region, elem));
+	}
+}
+
+/* Gives DST, the SPT of a child in the middle of fork, a mapping
+ * of its own for each mapping of SRC, in the same order, each
+ * reopening the file once for all of its pages.  Returns false if
+ * memory runs out; the child's exit closes what was reopened. */
+bool
+mmap_copy_all (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	struct list_elem *e;
+
+	for (e = list_begin (&src->mmaps); e != list_end (&src->mmaps);
+			e = list_next (e)) {
+		struct mmap_region *region = list_entry (e, struct mmap_region, elem);
+		struct mmap_region *copy = malloc (sizeof *copy);
+
+		if (copy == NULL)
+			return false;
+		copy->addr = region->addr;
+		copy->file = file_reopen (region->file);
+		if (copy->file == NULL) {
+			free (copy);
+			return false;
+		}
+		inode_map (file_get_inode (copy->file));
+		list_push_back (&dst->mmaps, &copy->elem);
+	}
+	return true;
+}
+
+/* Returns the file of DST's copy of the mapping of SRC that reads
+ * FILE, or a null pointer if no mapping of SRC reads FILE.  DST must
+ * have been filled by mmap_copy_all(). */
+struct file *
+mmap_copy_file (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src, struct file *file) {
+	struct list_elem *d, *s;
+
+	for (d = list_begin (&dst->mmaps), s = list_begin (&src->mmaps);
+			s != list_end (&src->mmaps); d = list_next (d), s = list_next (s))
+		if (list_entry (s, struct mmap_region, elem)->file == file)
+			return list_entry (d, struct mmap_region, elem)->file;
+	return NULL;
+}
+
+/* Returns the file that backs PAGE of a mapping, whether or not
+ * the page has been faulted in yet. */
+static struct file *
+mapped_file (struct page *page) {
+	if (VM_TYPE (page->operations->type) == VM_UNINIT)
+		return page->uninit.lazy.file;
+	return page->file.file;
+}
 
 /* Do the munmap */
 void
 do_munmap (void *addr) {
-	struct page* page;
-	while(page = spt_find_page(&thread_current()->spt, addr)){
-		//struct page* page = spt_find_page(&thread_current()->spt, addr);
-	//현재 가상 주소가 들어있는 supplemental page table 에서 page 찾기 
-		//if (page == NULL)
-			//break;
-		struct lazy_load_info *container = (struct lazy_load_info *)page->uninit.aux;
-		// container 을 사용해도 되고, file type object 의 멤버 변수들을 가져와도 된다.
-		if (pml4_is_dirty(thread_current()->pml4, page->va)){
-		//pml4가 dirty 상태 -> 변경이력이 있는 상태 
-		//PTE가 install된 뒤 변경된 상태 
-		//pml4 인자로 뭘 넣어야하지? virutal page 주소도 찾아야함 
-		//wirte at을 위해 container 의 정보들이 필요함 어떻게 가져오지?
-		//file 은 page type -> 페이지가 file 형태일 경우 관련된 정보를 가져올 수 있다.		
-		//dirty bit 체크
-			file_write_at(container->file, addr, container->page_read_bytes, container->offset);
-		//현재 page의 변경 사항을 disk file에 업데이트 
-			pml4_set_dirty(thread_current()->pml4, page, 0);		
-		}// pml4에 대한 변경사항이 있을 경우 디스크에 업데이트 해주고
-		pml4_clear_page(thread_current()->pml4, page->va);
-		//pml4 자체는 clear해준다. vpage는 virutal page이므로 page의 virtual address
-		//그냥 page가 들어가면 구조체의 주소, vpage로 pml4e_walk를 하므로 address가 들어가야한다.
-		
-		addr += PGSIZE;
+	struct thread *cur = thread_current ();
+	struct supplemental_page_table *spt = &cur->spt;
+	struct mmap_region *region = mmap_find (spt, addr);
+	struct page *page;
+	void *start = addr, *end = addr;
+
+	if (region == NULL)
+		return;
+
+	/* Pages of one mapping share its reopened file.  Write back the
+	 * dirty ones while the PTEs still tell which ones were modified. */
+	while ((page = spt_find_page (spt, end)) != NULL
+			&& page_get_type (page) == VM_FILE && mapped_file (page) == region->file)
+		end += PGSIZE;
+	vm_msync (start, end - start);
+
+	/* Unmap the whole region with one page table walk and at most one
+	 * TLB flush, then drop the pages. */
+	pml4_clear_range (cur->pml4, start, end);
+	for (addr = start; addr < end; addr += PGSIZE) {
+		page = spt_find_page (spt, addr);
+		ohash_delete (&spt->spt_hash, &page->hash_elem);
+		vm_free_frame (page);
+		vm_dealloc_page (page);
 	}
+
+	/* vm_free_frame() waited out any eviction writing the pages back,
+	 * so nothing reads the file any more. */
+	list_remove (&region->elem);
+	mmap_region_close (region);
 }
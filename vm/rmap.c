@@ -0,0 +1,110 @@
+/* rmap.c: Reverse map from a frame to the pages mapping it. */
+
+#include "vm/rmap.h"
+#include <debug.h>
+#include "threads/malloc.h"
+
+/* Returns the location of entry IDX of RMAP, which must exist. */
+static struct page **
+rmap_slot (struct rmap *rmap, size_t idx) {
+	struct rmap_chunk *chunk;
+
+	ASSERT (idx < rmap->cnt);
+	if (idx < RMAP_INLINE)
+		return &rmap->pages[idx];
+	idx -= RMAP_INLINE;
+	for (chunk = rmap->spill; idx >= RMAP_CHUNK; idx -= RMAP_CHUNK)
+		chunk = chunk->next;
+	return &chunk->pages[idx];
+}
+
+void
+rmap_init (struct rmap *rmap) {
+	rmap->cnt = 0;
+	rmap->spill = NULL;
+}
+
+/* Adds PAGE to RMAP.  Returns false if memory for a new chunk runs
+ * out, which cannot happen while RMAP has fewer than RMAP_INLINE
+ * entries, as it does for a frame just allocated. */
+bool
+rmap_add (struct rmap *rmap, struct page *page) {
+	size_t idx = rmap->cnt;
+
+	if (idx >= RMAP_INLINE && (idx - RMAP_INLINE) % RMAP_CHUNK == 0) {
+		struct rmap_chunk **next = &rmap->spill;
+		struct rmap_chunk *chunk = malloc (sizeof *chunk);
+
+		if (chunk == NULL)
+			return false;
+		while (*next != NULL)
+			next = &(*next)->next;
+		chunk->next = NULL;
+		*next = chunk;
+	}
+	rmap->cnt++;
+	*rmap_slot (rmap, idx) = page;
+	return true;
+}
+
+/* Removes and returns the last entry of RMAP, which must not be
+ * empty, freeing the chunk it leaves empty, if any. */
+struct page *
+rmap_pop (struct rmap *rmap) {
+	size_t idx = rmap->cnt - 1;
+	struct page *page = *rmap_slot (rmap, idx);
+
+	if (idx >= RMAP_INLINE && (idx - RMAP_INLINE) % RMAP_CHUNK == 0) {
+		struct rmap_chunk **last = &rmap->spill;
+
+		while ((*last)->next != NULL)
+			last = &(*last)->next;
+		free (*last);
+		*last = NULL;
+	}
+	rmap->cnt--;
+	return page;
+}
+
+/* Removes PAGE, which must be in it, from RMAP.  The last entry
+ * takes its place. */
+void
+rmap_remove (struct rmap *rmap, struct page *page) {
+	struct rmap_iter i;
+	struct page *p;
+	size_t idx = 0;
+
+	for (p = rmap_first (rmap, &i); p != page; p = rmap_next (&i)) {
+		ASSERT (p != NULL);
+		idx++;
+	}
+	p = rmap_pop (rmap);
+	if (idx < rmap->cnt)
+		*rmap_slot (rmap, idx) = p;
+}
+
+/* Starts iterator I over RMAP and returns its first page, or a
+ * null pointer if it is empty. */
+struct page *
+rmap_first (const struct rmap *rmap, struct rmap_iter *i) {
+	i->rmap = rmap;
+	i->idx = 0;
+	i->chunk = rmap->spill;
+	return rmap->cnt > 0 ? rmap->pages[0] : NULL;
+}
+
+/* Advances iterator I and returns the next page, or a null
+ * pointer if there are no more. */
+struct page *
+rmap_next (struct rmap_iter *i) {
+	size_t idx = ++i->idx;
+
+	if (idx >= i->rmap->cnt)
+		return NULL;
+	if (idx < RMAP_INLINE)
+		return i->rmap->pages[idx];
+	idx -= RMAP_INLINE;
+	if (idx > 0 && idx % RMAP_CHUNK == 0)
+		i->chunk = i->chunk->next;
+	return i->chunk->pages[idx % RMAP_CHUNK];
+}
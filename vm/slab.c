@@ -0,0 +1,126 @@
+/* slab.c: Pools of fixed-size objects for VM metadata. */
+
+#include "vm/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A free object, linked through its first bytes. */
+struct slab_obj {
+	struct slab_obj *next;
+};
+
+/* Header at the start of every slab page. */
+struct slab {
+	struct list_elem elem;      /* Element in the pool's partial list. */
+	struct slab_obj *free;      /* Free objects in this slab. */
+	size_t used;                /* Objects handed out from this slab. */
+};
+
+/* Offset of the first object in a slab. */
+#define SLAB_HEADER ROUND_UP (sizeof (struct slab), sizeof (void *))
+
+/* Initializes POOL to hand out objects of SIZE bytes, which must
+ * fit in a slab. */
+void
+slab_pool_init (struct slab_pool *pool, const char *name, size_t size) {
+	if (size < sizeof (struct slab_obj))
+		size = sizeof (struct slab_obj);
+	pool->name = name;
+	pool->size = ROUND_UP (size, sizeof (void *));
+	pool->per_slab = (PGSIZE - SLAB_HEADER) / pool->size;
+	ASSERT (pool->per_slab > 0);
+	list_init (&pool->partial);
+	lock_init (&pool->lock);
+	pool->slab_cnt = 0;
+	pool->used_cnt = 0;
+}
+
+/* Gets a fresh slab for POOL and adds it to the partial list.
+ * Returns false if the kernel pool is exhausted. */
+static bool
+slab_grow (struct slab_pool *pool) {
+	struct slab *slab = palloc_get_page (0);
+	uint8_t *obj;
+	size_t i;
+
+	if (slab == NULL)
+		return false;
+	slab->free = NULL;
+	slab->used = 0;
+	obj = (uint8_t *) slab + SLAB_HEADER + pool->per_slab * pool->size;
+	for (i = 0; i < pool->per_slab; i++) {
+		struct slab_obj *o = (struct slab_obj *) (obj -= pool->size);
+		o->next = slab->free;
+		slab->free = o;
+	}
+	list_push_front (&pool->partial, &slab->elem);
+	pool->slab_cnt++;
+	return true;
+}
+
+/* Allocates an object from POOL.  Its contents are unspecified.
+ * Returns a null pointer if memory is exhausted. */
+void *
+slab_alloc (struct slab_pool *pool) {
+	struct slab *slab;
+	struct slab_obj *obj;
+
+	lock_acquire (&pool->lock);
+	if (list_empty (&pool->partial) && !slab_grow (pool)) {
+		lock_release (&pool->lock);
+		return NULL;
+	}
+	slab = list_entry (list_front (&pool->partial), struct slab, elem);
+	obj = slab->free;
+	slab->free = obj->next;
+	slab->used++;
+	if (slab->free == NULL)
+		list_remove (&slab->elem);
+	pool->used_cnt++;
+	lock_release (&pool->lock);
+	return obj;
+}
+
+/* Returns OBJ, which slab_alloc() on POOL returned, to POOL.  A
+ * null pointer is ignored. */
+void
+slab_free (struct slab_pool *pool, void *obj_) {
+	struct slab_obj *obj = obj_;
+	struct slab *slab;
+	bool release = false;
+
+	if (obj == NULL)
+		return;
+	slab = pg_round_down (obj);
+
+	lock_acquire (&pool->lock);
+	ASSERT (slab->used > 0);
+	if (slab->free == NULL)
+		list_push_front (&pool->partial, &slab->elem);
+	obj->next = slab->free;
+	slab->free = obj;
+	slab->used--;
+	pool->used_cnt--;
+	if (slab->used == 0
+			&& (list_front (&pool->partial) != &slab->elem
+				|| list_next (&slab->elem) != list_end (&pool->partial))) {
+		list_remove (&slab->elem);
+		pool->slab_cnt--;
+		release = true;
+	}
+	lock_release (&pool->lock);
+
+	if (release)
+		palloc_free_page (slab);
+}
+
+/* Prints POOL's occupancy. */
+void
+slab_print_stats (struct slab_pool *pool) {
+	printf ("Slab %s: %zu objects of %zu bytes in use, %zu slabs"
+			" (%zu objects)\n", pool->name, pool->used_cnt, pool->size,
+			pool->slab_cnt, pool->slab_cnt * pool->per_slab);
+}
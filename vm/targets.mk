@@ -2,4 +2,6 @@ vm_SRC = vm/vm.c          # Main api proxy
 vm_SRC += vm/uninit.c     # Uninitialized page
 vm_SRC += vm/anon.c       # Anonymous page
 vm_SRC += vm/file.c       # File mapped page
+vm_SRC += vm/rmap.c       # Reverse map of frames
+vm_SRC += vm/slab.c       # Metadata object pools
 vm_SRC += vm/inspect.c    # Testing utility
@@ -8,6 +8,7 @@
  * function.
  * */
 
+#include <string.h>
 #include "vm/vm.h"
 #include "vm/uninit.h"
 
@@ -23,9 +24,11 @@ static const struct page_operations uninit_ops = {
 };
 
 /* DO NOT MODIFY this function */
+/* AUX is not kept: the caller copies the loader's argument into
+ * uninit.lazy (see vm_alloc_page_with_initializer()). */
 void
 uninit_new (struct page *page, void *va, vm_initializer *init,
-		enum vm_type type, void *aux,
+		enum vm_type type, void *aux UNUSED,
 		bool (*initializer)(struct page *, enum vm_type, void *)) {
 	ASSERT (page != NULL);
 
@@ -36,11 +39,9 @@ uninit_new (struct page *page, void *va, vm_initializer *init,
 		.uninit = (struct uninit_page) {
 			.init = init,
 			.type = type,
-			.aux = aux,
 			.page_initializer = initializer,
 
 		//멤버이름과 값을 적어서 초기화 하는 형태 
-		//struct page에 aux에 대한 정보를 멤버 변수로 넘겨서 초기화 
 		}
 	};
 }
@@ -52,11 +53,27 @@ uninit_initialize (struct page *page, void *kva) {
 
 	/* Fetch first, page_initialize may overwrite the values */
 	vm_initializer *init = uninit->init;
-	void *aux = uninit->aux;
+	struct lazy_load_info lazy = uninit->lazy;
+
+	/* A page without a loader, such as a stack page, starts out
+	 * zero-filled; its frame may last have held another process's
+	 * data. */
+	if (init == NULL)
+		memset (kva, 0, PGSIZE);
 
 	/* TODO: You may need to fix this function. */
 	return uninit->page_initializer (page, uninit->type, kva) &&
-		(init ? init (page, aux) : true);
+		(init ? init (page, &lazy) : true);
+}
+
+/* Turns PAGE into its final type like uninit_initialize(), but
+ * without running its lazy loader: the caller has already put the
+ * contents at KVA (see vm_fault_around()). */
+bool
+uninit_preload (struct page *page, void *kva) {
+	struct uninit_page *uninit = &page->uninit;
+
+	return uninit->page_initializer (page, uninit->type, kva);
 }
 
 /* Free the resources hold by uninit_page. Although most of pages are transmuted
@@ -68,9 +85,6 @@ uninit_destroy (struct page *page) {
 	struct uninit_page *uninit UNUSED = &page->uninit;
 	/* TODO: Fill this function.
 	 * TODO: If you don't have anything to do, just return. */
-	struct lazy_load_info * info = (struct lazy_load_info *)(uninit->aux);
-	file_close(&info->file);
-	
-	// 'file_close' frees 'info'
-	//free(info); // malloc in 'process.c load_segment' or 'hash_action_copy'
+	// The file is shared by every page of the segment or mapping and
+	// the lazy load info lives in the page itself, so nothing is ours.
 }
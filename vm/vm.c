@@ -1,8 +1,244 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bitmap.h>
+#include "devices/timer.h"
+#include "filesys/inode.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
+#include "intrinsic.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/slab.h"
+
+/* Frame table: every user frame that is mapped to a page, in
+ * clock order.  Protected by frame_lock.  Eviction saves its victim
+ * with the lock released, and a page on a frame being evicted is
+ * left alone until evict_done says it is saved (see
+ * page_wait_evicted()), so that it cannot be faulted back in, freed
+ * or shared before its contents are. */
+static struct list frame_table;
+static struct list_elem *clock_hand;    /* Next frame the clock looks at. */
+static size_t frame_cnt;                /* Frames in frame_table. */
+static struct lock frame_lock;
+static struct condition evict_done;     /* An eviction saved its victim. */
+
+/* The struct frame of every page of the user pool, indexed by
+ * frame number within the pool.  Looking a frame up by its kernel
+ * address is an index computation, and a frame costs no allocation
+ * when a page is loaded or evicted. */
+static struct frame *frame_array;
+
+/* Every struct page comes from this pool rather than malloc(). */
+static struct slab_pool page_pool;
+
+/* Fault-around.  A fault on a page that is still to be loaded from
+ * a file also reads in up to fault_around_pages - 1 following pages of
+ * the same region with one contiguous read into fault_around_buf,
+ * and maps them, so a sequential scan takes one fault per window
+ * instead of one per page.  Set with -fa=PAGES; 1 turns it off.
+ * Pages advised MADV_SEQUENTIAL always get the largest window and
+ * MADV_RANDOM ones none.
+ * Neighbours only get free frames; nothing is evicted for them. */
+#define FAULT_AROUND_MAX 16
+size_t fault_around_pages = 8;
+static uint8_t *fault_around_buf;       /* FAULT_AROUND_MAX - 1 pages. */
+static struct lock fault_around_lock;
+static long long fault_around_cnt;      /* Pages mapped ahead of a fault. */
+
+/* The shared zero page.  A read fault on an anonymous page that
+ * would start out zero-filled (stack, bss, or a lazily allocated
+ * anonymous page) maps this one read-only page instead of a frame
+ * of its own, and the page only gets a private frame on its first
+ * write fault (see vm_handle_wp()).  Such a page is anonymous,
+ * has no frame and no swap slot.  The zero page is not in the
+ * frame table and is never evicted. */
+static void *zero_page;
+static long long zero_map_cnt;          /* Read faults served by it. */
+
+/* Text cache: frames holding executable text, keyed by (inode,
+ * offset, length), so that every process running a program maps
+ * the same frames for its read-only segments.  A frame leaves the
+ * cache in frame_unlink(), once the last page mapping it is gone
+ * or it is evicted, which unmaps it from every process first.
+ * Protected by frame_lock. */
+static struct ohash text_cache;
+static long long text_hit_cnt;          /* Faults served from it. */
+
+static hash_hash_func frame_hash;
+static hash_less_func frame_less;
+
+/* Write-back of mapped files.  Every FLUSH_TICKS the flusher
+ * thread writes the dirty pages of every file mapping back to
+ * their files, as msync() does for one range on request and
+ * munmap() for the region it unmaps, so dirty data neither piles
+ * up nor all waits for munmap() or exit.  Dirty pages are sorted
+ * by file and offset, and each run of contiguous ones is copied
+ * into flush_buf and written with one call.  The pages are
+ * gathered under frame_lock, with their frames pinned so that they
+ * are neither evicted nor freed, and written with it released, so
+ * that faults and evictions go on during the writes.  Flushes take
+ * turns through flush_lock, which protects everything here. */
+#define FLUSH_TICKS (5 * TIMER_FREQ)
+#define FLUSH_CLUSTER_MAX 16
+
+/* A dirty page of a file mapping on its way to the file.  It keeps
+ * what the write needs, so that the page may be unmapped
+ * meanwhile: the frame, pinned, and the inode, reopened. */
+struct flush_rec {
+	struct frame *frame;
+	struct inode *inode;
+	off_t offset;
+	size_t length;
+};
+
+#define FLUSH_BATCH (PGSIZE / sizeof (struct flush_rec))
+static struct lock flush_lock;
+static uint8_t *flush_buf;              /* FLUSH_CLUSTER_MAX pages. */
+static struct flush_rec *flush_batch;   /* Dirty pages to write back. */
+static size_t flush_cnt;                /* Pages in flush_batch. */
+static long long flush_write_cnt;       /* Writes issued. */
+static long long flush_page_cnt;        /* Pages written. */
+
+static void vm_flushd (void *aux);
+
+/* Page aging.  Every AGE_TICKS the aging thread samples and
+ * clears the accessed bits of every frame in the frame table: a
+ * frame that was used is made age 0, any other one a period older,
+ * up to AGE_MAX.  A frame's age thus tells roughly how long it has
+ * gone unused, which lets eviction prefer frames that are really
+ * cold (see vm_get_victim()), and gives each process a working-set
+ * estimate: its resident pages used within the last WS_AGE periods
+ * (see vm_working_set()).
+ *
+ * Clearing an accessed bit in an address space that is not loaded
+ * marks its PCID stale, so the process loses all of its TLB entries
+ * the next time it runs.  The period is therefore kept long: each
+ * process that ran pays one TLB flush per period at most, and one
+ * that did not run has no accessed bit to clear and pays none. */
+#define AGE_TICKS TIMER_FREQ
+#define AGE_MAX UINT8_MAX
+#define AGE_COLD 2              /* Periods unused to be taken at once. */
+#define WS_AGE 4                /* Periods a page stays in the working set. */
+#define EVICT_SCAN 32           /* Idle frames compared per eviction. */
+static long long age_pass_cnt;          /* Sampling passes. */
+static long long evict_cold_cnt;        /* Victims at least AGE_COLD old. */
+
+static void vm_aged (void *aux);
+
+/* Deferred teardown.  An exiting process writes its file mappings
+ * back, then hands its pages and page table to the reaper thread,
+ * so that a parent waiting for it gets the exit status without
+ * waiting for every page to be freed.  The reaper frees pages in
+ * batches of REAP_BATCH, taking frame_lock once per batch, and then
+ * destroys the page table.  Until then the dead pages, marked as
+ * such, stay in the frame table, where eviction takes their frames
+ * before any other and frees them without saving their data; their
+ * page table is intact for it. */
+#define REAP_BATCH 64
+struct reap_req {
+	struct ohash spt;               /* The process's pages. */
+	uint64_t *pml4;                 /* Its page table. */
+	struct list_elem elem;          /* In reap_list. */
+};
+static struct list reap_list;
+static struct lock reap_lock;           /* Protects reap_list. */
+static struct semaphore reap_sema;      /* Counts requests in reap_list. */
+static long long reap_proc_cnt;         /* Address spaces torn down. */
+static long long reap_page_cnt;         /* Pages freed. */
+static long long reap_batch_cnt;        /* Batches they took. */
+
+static void vm_reaperd (void *aux);
+
+/* Startup prefetch.  Every run of a program faults in nearly the
+ * same pages of its executable in nearly the same order.  The first
+ * run of an executable records the first STARTUP_TRACE_MAX of them
+ * and, once it execs or exits, leaves the trace in startup_table,
+ * keyed by the executable's inode.  Later runs look their
+ * executable up right after loading it and read all the traced
+ * pages that are not in the text cache in file order, in
+ * contiguous runs that fit fault_around_buf, before they
+ * enter user mode.  Like fault-around, this only uses free frames.
+ * The table keeps the STARTUP_TABLE_MAX executables used most
+ * recently. */
+#define STARTUP_TRACE_MAX 64
+#define STARTUP_TABLE_MAX 16
+struct startup_trace {
+	struct inode *inode;            /* Executable. */
+	unsigned long long stamp;       /* Last use, for replacement. */
+	size_t cnt;                     /* Pages in VA. */
+	void *va[STARTUP_TRACE_MAX];    /* Pages in the order they faulted. */
+};
+static struct startup_trace *startup_table[STARTUP_TABLE_MAX];
+static struct lock startup_lock;        /* Protects startup_table. */
+static unsigned long long startup_clock;
+static long long startup_trace_cnt;     /* Traces recorded. */
+static long long startup_page_cnt;      /* Pages prefetched. */
+static long long startup_read_cnt;      /* Reads they took. */
+
+/* Locked pages.  mlock() faults a range in and marks its pages
+ * mlocked; eviction skips every frame that an mlocked page maps
+ * (see frame_mlocked()), so the range stays resident until it is
+ * unlocked or unmapped.  A process may lock up to MLOCK_PROC_MAX
+ * pages, and the system up to mlock_max_pages (-mlock=PAGES, at
+ * most half the user pool), so that eviction always has frames to
+ * take.  read() and write() on a locked buffer also move the data
+ * straight between the file and the buffer's frames (see
+ * vm_mlocked_kva()).  mlock_cnt is protected by frame_lock. */
+#define MLOCK_PROC_MAX 256
+size_t mlock_max_pages = 1024;
+static size_t mlock_cnt;                /* Pages locked. */
+static long long mlock_io_cnt;          /* Pages of I/O done in place. */
+
+/* Same-page merging.  With -ksm=PAGES, the merging thread looks at
+ * PAGES frames of the frame table every MERGE_TICKS, searching for
+ * anonymous pages with the same contents, such as the ones forked
+ * children fill in the same way.  It checksums every frame mapped
+ * only by writable anonymous pages that are not mlocked, and keeps
+ * the frame as a candidate if its checksum is the same as on the
+ * previous pass, since a page that keeps changing is not worth
+ * merging.  Once the hand has been over the whole frame table, the
+ * candidates are sorted by checksum and those with equal checksums
+ * are compared byte for byte.  Every frame equal to the first one
+ * of its run has its pages moved onto that frame, mapped
+ * read-only, and is freed.  A write to any of them then takes a
+ * copy, as after fork (see vm_handle_wp()); so does a kernel
+ * write, such as read() into a merged buffer, since CR0.WP makes
+ * it fault the same way.  merge_hand is
+ * protected by frame_lock; the rest belongs to the merging
+ * thread. */
+#define MERGE_TICKS (TIMER_FREQ / 10)
+#define MERGE_BATCH 32          /* Frames checksummed per frame_lock hold. */
+#define MERGE_BUF_PAGES 4
+#define MERGE_MAX (MERGE_BUF_PAGES * PGSIZE / sizeof (struct merge_entry))
+struct merge_entry {
+	uint64_t sum;                   /* Checksum of FRAME's contents. */
+	struct frame *frame;
+};
+size_t merge_scan_pages = 0;
+static struct merge_entry *merge_buf;   /* Candidates of this pass. */
+static size_t merge_cnt;                /* Entries in merge_buf. */
+static struct list_elem *merge_hand;    /* Next frame to look at. */
+static long long merge_pass_cnt;        /* Passes over the frame table. */
+static long long merge_scan_cnt;        /* Frames checksummed. */
+static long long merge_cycles;          /* Time the thread took. */
+static long long merge_page_cnt;        /* Pages merged. */
+static long long merge_miss_cnt;        /* Equal checksums, other data. */
+
+static void vm_merged (void *aux);
+
+/* Page faults of the whole system; each process also has its own
+ * (see vm_try_handle_fault()).  Updated with interrupts off. */
+static struct fault_stats fault_stats_all;
+bool fault_stats_print;
+
+/* Eviction statistics. */
+static long long evict_cnt;             /* Frames evicted. */
+static long long evict_scan_cnt;        /* Frames the clock hand passed. */
+static long long evict_dirty_cnt;       /* Victims that were dirty. */
 
 
 //#define DBG
@@ -21,12 +257,54 @@ void
 vm_init (void) {
 	vm_anon_init ();
 	vm_file_init ();
-#ifdef EFILESYS  /* For project 4 */
-	pagecache_init ();
-#endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
+	list_init (&frame_table);
+	lock_init (&frame_lock);
+	cond_init (&evict_done);
+	clock_hand = NULL;
+	frame_array = calloc (palloc_user_page_cnt (), sizeof *frame_array);
+	if (frame_array == NULL)
+		PANIC ("vm: out of memory");
+	slab_pool_init (&page_pool, "page", sizeof (struct page));
+
+	ohash_init (&text_cache, frame_hash, frame_less, NULL);
+	zero_page = palloc_get_page (PAL_ZERO);
+	if (zero_page == NULL)
+		PANIC ("vm: out of memory");
+
+	lock_init (&fault_around_lock);
+	if (fault_around_pages > FAULT_AROUND_MAX)
+		fault_around_pages = FAULT_AROUND_MAX;
+	fault_around_buf = palloc_get_multiple (0, FAULT_AROUND_MAX - 1);
+	if (fault_around_buf == NULL)
+		fault_around_pages = 1;
+
+	lock_init (&flush_lock);
+	flush_buf = palloc_get_multiple (0, FLUSH_CLUSTER_MAX);
+	flush_batch = palloc_get_page (0);
+	if (flush_buf == NULL || flush_batch == NULL)
+		PANIC ("vm: out of memory");
+	thread_create ("kflushd", PRI_DEFAULT, vm_flushd, NULL);
+	thread_create ("kaged", PRI_DEFAULT, vm_aged, NULL);
+
+	lock_init (&startup_lock);
+
+	if (mlock_max_pages > palloc_user_page_cnt () / 2)
+		mlock_max_pages = palloc_user_page_cnt () / 2;
+
+	if (merge_scan_pages > 0) {
+		merge_buf = palloc_get_multiple (0, MERGE_BUF_PAGES);
+		if (merge_buf == NULL)
+			PANIC ("vm: out of memory");
+		thread_create ("kmerged", PRI_DEFAULT, vm_merged, NULL);
+	}
+
+	list_init (&reap_list);
+	lock_init (&reap_lock);
+	sema_init (&reap_sema, 0);
+	thread_create ("kreaperd", PRI_DEFAULT, vm_reaperd, NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -47,6 +325,9 @@ page_get_type (struct page *page) {
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static bool vm_preload (struct page **pages, struct frame **frames,
+		size_t cnt, size_t bytes);
+static void mlock_set (struct page *page, bool lock);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -66,25 +347,36 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		 * TODO: should modify the field after calling the uninit_new. */
 
 		bool (*initializer)(struct page *, enum vm_type, void *);
-		switch(type){
+		// marker bits (stack, executable text) don't pick the initializer
+		switch(VM_TYPE(type)){
 			// # ifdef DEBUG 
 			// case VM_UNINIT:
 			// 	initializer = uninit_initialize;
 			// 	break;
-			case VM_ANON: case VM_ANON|VM_MARKER_0:
+			case VM_ANON:
 				initializer = anon_initializer;
 				break;
 			case VM_FILE:
 				initializer = file_backed_initializer;
 				break;
+			default:
+				goto err;
 		}
 		
-		struct page *new_page = malloc(sizeof(struct page));
+		struct page *new_page = slab_alloc (&page_pool);
+		if (new_page == NULL)
+			goto err;
 		// new_page->va = upage;
 		// vm_do_claim_page(new_page); // #ifdef DBG - false일때 처리?
 		uninit_new (new_page, upage, init, type, aux, initializer);
+		// AUX is the loader's struct lazy_load_info, kept in the page
+		if (aux != NULL)
+			new_page->uninit.lazy = *(struct lazy_load_info *) aux;
 
 		new_page->writable = writable;
+		new_page->advice = MADV_NORMAL;
+		new_page->mlocked = false;
+		new_page->dead = false;
 
 		/* TODO: Insert the page into the spt. */
 		spt_insert_page(spt, new_page); // should always return true - checked that upage is not in spt
@@ -104,7 +396,7 @@ spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
 	/* TODO: Fill this function. */
 	struct page dummy_page; dummy_page.va = pg_round_down(va); // dummy for hashing
 	struct hash_elem *e;
-	e = hash_find(&spt->spt_hash, &dummy_page.hash_elem);
+	e = ohash_find(&spt->spt_hash, &dummy_page.hash_elem);
 
 	if(e == NULL)
 		return NULL;
@@ -122,99 +414,1536 @@ spt_insert_page (struct supplemental_page_table *spt UNUSED,
 	// checks that the virtual address does not exist in the given supplemental page table.
 	// Q. 그래서 만약 이미 SPT에 page 있으면 넣지 마? 아니면 replace해?
 	// > succ 있는거 보니까, 이미 있으면 넣지 말고 false return 하는 것 같음
-	struct hash_elem *e = hash_find(&spt->spt_hash, &page->hash_elem);
-	if(e != NULL) // page already in SPT
-		return succ; // false, fail
-
-	// page not in SPT
-	hash_insert (&spt->spt_hash, &page->hash_elem);	
-	return succ = true;
+	// ohash_insert() returns the existing page instead of inserting
+	succ = ohash_insert (&spt->spt_hash, &page->hash_elem) == NULL;
+	return succ;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	pml4_clear_page(thread_current()->pml4, page->va);
-	hash_delete(&spt->spt_hash, &page->hash_elem);
+	ohash_delete(&spt->spt_hash, &page->hash_elem);
+	vm_free_frame (page);
 	vm_dealloc_page (page);
+}
+
+/* Returns true if any page mapping FRAME was accessed since the
+ * clock hand last passed, clearing the accessed bits. */
+static bool
+frame_test_and_clear_accessed (struct frame *frame) {
+	bool accessed = false;
+	struct rmap_iter i;
+	struct page *page;
+
+	for (page = rmap_first (&frame->rmap, &i); page != NULL;
+			page = rmap_next (&i)) {
+		if (pml4_is_accessed (page->pml4, page->va)) {
+			pml4_set_accessed (page->pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* Returns true if any page mapping FRAME is mlocked.  Must be
+ * called with frame_lock held. */
+static bool
+frame_mlocked (struct frame *frame) {
+	struct rmap_iter i;
+	struct page *page;
+
+	for (page = rmap_first (&frame->rmap, &i); page != NULL;
+			page = rmap_next (&i))
+		if (page->mlocked)
+			return true;
+	return false;
+}
+
+/* Returns true if FRAME is mapped only by pages of exited processes
+ * that the reaper has yet to free.  Must be called with frame_lock
+ * held. */
+static bool
+frame_dead (struct frame *frame) {
+	struct rmap_iter i;
+	struct page *page;
+
+	page = rmap_first (&frame->rmap, &i);
+	if (page == NULL)
+		return false;
+	for (; page != NULL; page = rmap_next (&i))
+		if (!page->dead)
+			return false;
+	return true;
+}
+
+/* Takes FRAME out of the frame table and the text cache.  Must be
+ * called with frame_lock held. */
+static void
+frame_unlink (struct frame *frame) {
+	if (clock_hand == &frame->elem)
+		clock_hand = list_next (clock_hand);
+	if (merge_hand == &frame->elem)
+		merge_hand = list_next (merge_hand);
+	list_remove (&frame->elem);
+	frame_cnt--;
+	if (frame->inode != NULL) {
+		ohash_delete (&text_cache, &frame->cache_elem);
+		frame->inode = NULL;
+	}
+}
+
+/* Takes FRAME, which just lost a page, out of the frame table if
+ * no page maps it any more and returns true; the caller then frees
+ * it.  A pinned frame is left to whoever pinned it.  Must be called
+ * with frame_lock held. */
+static bool
+frame_put (struct frame *frame) {
+	if (rmap_count (&frame->rmap) > 0 || frame->pinned)
+		return false;
+	frame_unlink (frame);
+	return true;
+}
+
+/* Ages FRAME by one sampling period, or makes it young again if
+ * it was used.  Must be called with frame_lock held. */
+static void
+frame_age (struct frame *frame) {
+	if (frame_test_and_clear_accessed (frame))
+		frame->age = 0;
+	else if (frame->age < AGE_MAX)
+		frame->age++;
+}
+
+/* Aging thread: periodically samples the accessed bits of every
+ * frame. */
+static void
+vm_aged (void *aux UNUSED) {
+	for (;;) {
+		struct list_elem *e;
+
+		timer_sleep (AGE_TICKS);
+		lock_acquire (&frame_lock);
+		for (e = list_begin (&frame_table); e != list_end (&frame_table);
+				e = list_next (e))
+			frame_age (list_entry (e, struct frame, elem));
+		age_pass_cnt++;
+		lock_release (&frame_lock);
+	}
+}
+
+/* Returns a 64-bit checksum of the page at KVA: FNV-1a over its
+ * words rather than its bytes. */
+static uint64_t
+page_checksum (const void *kva) {
+	const uint64_t *w = kva;
+	uint64_t sum = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for (i = 0; i < PGSIZE / sizeof *w; i++)
+		sum = (sum ^ w[i]) * 0x100000001b3ULL;
+	return sum;
+}
+
+/* Returns true if FRAME holds a page that may be merged: it is not
+ * pinned, and it is mapped, only by writable anonymous pages that
+ * are not mlocked.  Must be called with frame_lock held. */
+static bool
+frame_mergeable (struct frame *frame) {
+	struct rmap_iter i;
+	struct page *page;
+
+	if (frame->pinned || frame->inode != NULL
+			|| rmap_count (&frame->rmap) == 0)
+		return false;
+	for (page = rmap_first (&frame->rmap, &i); page != NULL;
+			page = rmap_next (&i))
+		if (VM_TYPE (page->operations->type) != VM_ANON || !page->writable
+				|| page->mlocked)
+			return false;
+	return true;
+}
+
+/* Makes every page mapping FRAME read-only.  Must be called with
+ * frame_lock held. */
+static void
+frame_write_protect (struct frame *frame) {
+	struct rmap_iter i;
+	struct page *page;
+
+	for (page = rmap_first (&frame->rmap, &i); page != NULL;
+			page = rmap_next (&i))
+		pml4_set_writable (page->pml4, page->va, false);
+}
+
+/* Moves the pages mapping SRC onto DST, read-only, and frees SRC,
+ * if both frames may still be merged and hold the same data.
+ * Returns true if successful.  Must be called with frame_lock
+ * held. */
+static bool
+merge_frames (struct frame *dst, struct frame *src) {
+	struct rmap_iter i;
+	struct page *page;
+	size_t added = 0;
+
+	/* A frame freed and reused during the pass is listed twice. */
+	if (dst == src || !frame_mergeable (dst) || !frame_mergeable (src))
+		return false;
+
+	/* Write-protected first, so that neither changes between the
+	 * comparison and the merge: a write now faults and waits for
+	 * frame_lock.  Pages that turn out to differ are left
+	 * read-only; vm_handle_wp() makes them writable again on their
+	 * next write. */
+	frame_write_protect (dst);
+	frame_write_protect (src);
+	if (memcmp (dst->kva, src->kva, PGSIZE) != 0) {
+		merge_miss_cnt++;
+		return false;
+	}
+
+	/* Entered in DST's rmap first, so that running out of memory
+	 * for it leaves both frames as they were. */
+	for (page = rmap_first (&src->rmap, &i); page != NULL;
+			page = rmap_next (&i)) {
+		if (!rmap_add (&dst->rmap, page)) {
+			while (added-- > 0)
+				rmap_pop (&dst->rmap);
+			return false;
+		}
+		added++;
+	}
+
+	while (rmap_count (&src->rmap) > 0) {
+		page = rmap_pop (&src->rmap);
+		page->frame = dst;
+		pml4_set_page (page->pml4, page->va, dst->kva, false);
+		merge_page_cnt++;
+	}
+	frame_unlink (src);
+	palloc_free_page (src->kva);
 	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Checksums up to merge_scan_pages frames from merge_hand on,
+ * MERGE_BATCH at a time, and records the candidates in merge_buf.
+ * Returns true once the hand has gone past the end of the frame
+ * table. */
+static bool
+merge_scan (void) {
+	size_t left = merge_scan_pages;
+	bool done = false;
+
+	while (left > 0 && !done) {
+		size_t n = left < MERGE_BATCH ? left : MERGE_BATCH;
+
+		lock_acquire (&frame_lock);
+		if (merge_hand == NULL)
+			merge_hand = list_begin (&frame_table);
+		for (; n > 0; n--, left--) {
+			struct frame *frame;
+			uint64_t sum;
+
+			if (merge_hand == list_end (&frame_table)) {
+				merge_hand = NULL;
+				done = true;
+				break;
+			}
+			frame = list_entry (merge_hand, struct frame, elem);
+			merge_hand = list_next (merge_hand);
+			if (!frame_mergeable (frame))
+				continue;
+
+			sum = page_checksum (frame->kva);
+			merge_scan_cnt++;
+			if (sum == frame->checksum && merge_cnt < MERGE_MAX) {
+				merge_buf[merge_cnt].sum = sum;
+				merge_buf[merge_cnt].frame = frame;
+				merge_cnt++;
+			}
+			frame->checksum = sum;
+		}
+		lock_release (&frame_lock);
+	}
+	return done;
+}
+
+/* Orders merge candidates by checksum. */
+static int
+merge_compare (const void *a_, const void *b_) {
+	const struct merge_entry *a = a_;
+	const struct merge_entry *b = b_;
+
+	if (a->sum != b->sum)
+		return a->sum < b->sum ? -1 : 1;
+	return 0;
+}
+
+/* Ends a pass: merges every candidate into the first one with the
+ * same checksum, if their data really are the same. */
+static void
+merge_pass (void) {
+	size_t i, j;
+
+	qsort (merge_buf, merge_cnt, sizeof *merge_buf, merge_compare);
+	for (i = 0; i < merge_cnt; i = j)
+		for (j = i + 1; j < merge_cnt && merge_buf[j].sum == merge_buf[i].sum;
+				j++) {
+			lock_acquire (&frame_lock);
+			merge_frames (merge_buf[i].frame, merge_buf[j].frame);
+			lock_release (&frame_lock);
+		}
+	merge_cnt = 0;
+	merge_pass_cnt++;
+}
+
+/* Merging thread: scans merge_scan_pages frames per period. */
+static void
+vm_merged (void *aux UNUSED) {
+	for (;;) {
+		uint64_t start;
+
+		timer_sleep (MERGE_TICKS);
+		start = rdtsc ();
+		if (merge_scan ())
+			merge_pass ();
+		merge_cycles += rdtsc () - start;
+	}
+}
+
+/* Picks the frame to evict with the clock (second chance)
+ * algorithm, refined by age: sweep the frame table, giving each
+ * recently accessed frame another lap by clearing its accessed
+ * bit, and take the first idle one that has gone unused for
+ * AGE_COLD sampling periods, or else the oldest of the next
+ * EVICT_SCAN idle ones.  The victim is removed from the frame
+ * table.  Must be called with frame_lock held. */
 static struct frame *
 vm_get_victim (void) {
-	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
+	/* Two laps clear every accessed bit, so only pinned frames can
+	 * keep the hand going longer than that. */
+	size_t budget = 2 * frame_cnt + 1;
+	struct frame *victim = NULL, *oldest = NULL;
+	size_t idle_cnt = 0;
+
+	while (budget-- > 0 && frame_cnt > 0) {
+		struct frame *frame;
+
+		if (clock_hand == NULL || clock_hand == list_end (&frame_table))
+			clock_hand = list_begin (&frame_table);
+		frame = list_entry (clock_hand, struct frame, elem);
+		clock_hand = list_next (clock_hand);
+		evict_scan_cnt++;
+
+		if (frame->pinned)
+			continue;
+		/* Costs nothing to take: see vm_evict_frame(). */
+		if (frame_dead (frame)) {
+			victim = frame;
+			break;
+		}
+		if (frame_mlocked (frame))
+			continue;
+		if (frame_test_and_clear_accessed (frame)) {
+			frame->age = 0;
+			continue;
+		}
+		if (frame->age >= AGE_COLD) {
+			victim = frame;
+			break;
+		}
+		if (oldest == NULL || frame->age > oldest->age)
+			oldest = frame;
+		if (++idle_cnt == EVICT_SCAN)
+			break;
+	}
 
+	if (victim == NULL)
+		victim = oldest;
+	if (victim == NULL)
+		PANIC ("vm: no frame to evict");
+	if (victim->age >= AGE_COLD)
+		evict_cold_cnt++;
+	frame_unlink (victim);
 	return victim;
 }
 
+/* Waits until PAGE is not on a frame being evicted, so that it is
+ * either resident or saved.  Must be called with frame_lock held,
+ * which is released while waiting. */
+static void
+page_wait_evicted (struct page *page) {
+	while (page->frame != NULL && page->frame->evicting)
+		cond_wait (&evict_done, &frame_lock);
+}
+
 /* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+ * The frame is no longer in the frame table and has no page.
+ * Must be called with frame_lock held, which is released while
+ * the victim's pages are saved. */
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
+	struct frame *victim = vm_get_victim ();
+	bool dirty = false;
+	struct rmap_iter i;
+	struct page *page;
+
+	/* Unmap first so the owners can't write behind our back while
+	 * the page is being saved.  The dirty bit survives
+	 * pml4_clear_page(), so swap_out() can still tell whether a
+	 * write-back is needed. */
+	for (page = rmap_first (&victim->rmap, &i); page != NULL;
+			page = rmap_next (&i)) {
+		dirty |= !page->dead && pml4_is_dirty (page->pml4, page->va);
+		pml4_clear_page (page->pml4, page->va);
+	}
 
-	return NULL;
+	/* The pages keep the frame while they are saved, so that whoever
+	 * wants one of them waits in page_wait_evicted(), and nothing
+	 * changes the rmap meanwhile.  A frame shared copy-on-write is
+	 * saved once per page, so each sharer owns its swap slot and
+	 * faults back into a frame of its own.  Pages of exited
+	 * processes are not saved at all; the reaper finds them without
+	 * a frame and just frees them. */
+	victim->pinned = true;
+	victim->evicting = true;
+	lock_release (&frame_lock);
+	for (page = rmap_first (&victim->rmap, &i); page != NULL;
+			page = rmap_next (&i))
+		if (!page->dead && !swap_out (page))
+			PANIC ("vm: cannot swap out page %p", page->va);
+	lock_acquire (&frame_lock);
+
+	while (rmap_count (&victim->rmap) > 0)
+		rmap_pop (&victim->rmap)->frame = NULL;
+	victim->evicting = false;
+	cond_broadcast (&evict_done, &frame_lock);
+
+	if (dirty)
+		evict_dirty_cnt++;
+	evict_cnt++;
+	return victim;
+}
+
+/* Returns the frame of KVA, a page of the user pool. */
+static struct frame *
+frame_of (void *kva) {
+	return &frame_array[palloc_user_page_idx (kva)];
+}
+
+/* Gets a frame from palloc, evicting one if the user pool is
+ * exhausted and MAY_EVICT, or returning a null pointer if not.
+ * The frame comes back pinned and already in the frame table; the
+ * caller unpins it once its page is loaded. */
+static struct frame *
+frame_alloc (bool may_evict) {
+	struct frame *frame;
+	void *kva;
+
+	/* Taking the lock also waits out an eviction in progress, which
+	 * may be of the very page we are about to load. */
+	lock_acquire (&frame_lock);
+	kva = palloc_get_page (PAL_USER);
+	if (kva != NULL) {
+		frame = frame_of (kva);
+		frame->kva = kva;
+	} else if (may_evict)
+		frame = vm_evict_frame ();
+	else {
+		lock_release (&frame_lock);
+		return NULL;
+	}
+
+	rmap_init (&frame->rmap);
+	frame->pinned = true;
+	frame->evicting = false;
+	frame->age = 0;
+	frame->checksum = 0;
+	frame->inode = NULL;
+	list_push_back (&frame_table, &frame->elem);
+	frame_cnt++;
+	lock_release (&frame_lock);
+	return frame;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * space.
+ * The frame comes back pinned; see frame_alloc(). */
 static struct frame *
 vm_get_frame (void) {
-	/* TODO: Fill this function. */
-	void * kva = palloc_get_page(PAL_USER);
-	if (kva == NULL){
-		// Todo... eviction
-		/*
-		Frame eviction은 어떻게 이루어질까?
-		> frame 얻기 위한 palloc 실패 시 
-		→ Replacement policy에 따라 frame table에서 가장 안 쓰이는 frame 하나 집어서, 기존 page와의 연결 끊고 새로운 page 연결
-
-		연결 끊긴 기존 page는 swap table에 저장 (swapped-out)
-		
-		struct frame은 한 번 만들면, page만 갈아끼우는 방식으로 재사용될 것 같음
-		그니까, 한번 할당한 frame kernel kva를 free 하는건 아닌 것 같음.
+	return frame_alloc (true);
+}
 
-		Q. swapped-out page에 파일의 어느 위치까지 읽었는지 offset같은거 저장해야 하지 않을까?
-		> struct file_page 같은데에 새로운 member 만들어야 할 듯?
+/* Frees FRAME, which frame_alloc() returned but no page uses. */
+static void
+frame_discard (struct frame *frame) {
+	lock_acquire (&frame_lock);
+	frame_unlink (frame);
+	lock_release (&frame_lock);
+	palloc_free_page (frame->kva);
+}
 
-		-- 확실하진 않지만 일단 디자인이 이럼 --
-		*/
+/* Drops PAGE's reference to its frame, if any, and frees the frame
+ * once no page maps it any more.  PAGE, a page of the current
+ * process, is no longer mlocked afterwards.  The caller takes care
+ * of PAGE's mapping. */
+void
+vm_free_frame (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	page_wait_evicted (page);
+	mlock_set (page, false);
+	frame = page->frame;
+	if (frame != NULL) {
+		rmap_remove (&frame->rmap, page);
+		page->frame = NULL;
+		if (!frame_put (frame))
+			frame = NULL;
 	}
+	lock_release (&frame_lock);
 
-	struct frame *frame = malloc(sizeof(struct frame)); // #ifdef DEBUG - what if this fails?
-	frame->kva = kva;
-	// frame->page = malloc(sizeof(struct page));
+	if (frame != NULL)
+		palloc_free_page (frame->kva);
+}
 
-	ASSERT (frame != NULL);
-	// ASSERT (frame->page == NULL); // #ifdef DEBUG
-	return frame;
+/* Gives the current process, in the middle of fork, a
+ * copy-on-write copy of SRC, a page of its parent.  A resident
+ * page's frame is mapped read-only into both processes; the first
+ * write from either side copies it (see vm_handle_wp()).  Returns
+ * true if successful.  Returns false with *IN_SWAP set if SRC is an
+ * anonymous page out in swap, which the caller has to copy itself,
+ * and with it cleared if memory runs out. */
+static bool
+vm_share_page (struct page *src, bool *in_swap) {
+	struct thread *t = thread_current ();
+	struct page *page = slab_alloc (&page_pool);
+	struct frame *frame;
+
+	*in_swap = false;
+	if (page == NULL)
+		return false;
+
+	lock_acquire (&frame_lock);
+	page_wait_evicted (src);
+	frame = src->frame;
+	if (frame == NULL && VM_TYPE (src->operations->type) == VM_ANON
+			&& src->anon.swap_slot != BITMAP_ERROR) {
+		lock_release (&frame_lock);
+		slab_free (&page_pool, page);
+		*in_swap = true;
+		return false;
+	}
+
+	/* Type, writability and per-type data (the file and offset of a
+	 * mapping) are the same; an evicted file page just reads back
+	 * from the file on the child's first fault. */
+	memcpy (page, src, sizeof *page);
+	page->pml4 = t->pml4;
+	page->mlocked = false;
+	if (frame != NULL && !rmap_add (&frame->rmap, page)) {
+		lock_release (&frame_lock);
+		slab_free (&page_pool, page);
+		return false;
+	}
+	if (page_is_text (page))
+		inode_reopen (page->file.inode);
+	if (frame != NULL) {
+		pml4_set_writable (src->pml4, src->va, false);
+		pml4_set_page (t->pml4, page->va, frame->kva, false);
+	} else if (VM_TYPE (src->operations->type) == VM_ANON)
+		pml4_set_page (t->pml4, page->va, zero_page, false);
+	lock_release (&frame_lock);
+
+	spt_insert_page (&t->spt, page);
+	return true;
+}
+
+/* Prints the page fault counts and, for each kind of fault that
+ * happened, its mean service time and service time histogram. */
+static void
+vm_print_fault_stats (void) {
+	static const char *names[FAULT_KIND_CNT] = {
+		"minor", "major", "copy-on-write", "stack growth", "invalid",
+	};
+	const struct fault_stats *s = &fault_stats_all;
+	int k, b;
+
+	printf ("Page faults: %llu minor, %llu major, %llu copy-on-write, "
+			"%llu stack growth, %llu invalid\n",
+			s->count[FAULT_MINOR], s->count[FAULT_MAJOR], s->count[FAULT_COW],
+			s->count[FAULT_STACK], s->count[FAULT_INVALID]);
+	for (k = 0; k < FAULT_KIND_CNT; k++) {
+		if (s->count[k] == 0)
+			continue;
+		printf ("  %s: %llu cycles mean, histogram from 2^%d cycles:",
+				names[k], s->cycles[k] / s->count[k], FAULT_HIST_SHIFT + 1);
+		for (b = 0; b < FAULT_HIST_BUCKETS; b++)
+			printf (" %u", s->hist[k][b]);
+		printf ("\n");
+	}
+}
+
+/* Prints eviction statistics. */
+void
+vm_print_stats (void) {
+	long long per_evict = evict_cnt ? evict_scan_cnt * 100 / evict_cnt : 0;
+
+	printf ("Eviction: %lld frames evicted, %lld.%02lld scans per eviction, "
+			"%lld dirty / %lld clean\n",
+			evict_cnt, per_evict / 100, per_evict % 100,
+			evict_dirty_cnt, evict_cnt - evict_dirty_cnt);
+	printf ("Fault-around: %lld pages mapped ahead of faults\n",
+			fault_around_cnt);
+	printf ("Zero page: %lld read faults mapped to it\n", zero_map_cnt);
+	printf ("Text cache: %lld faults served from it\n", text_hit_cnt);
+	printf ("Mapped write-back: %lld pages in %lld writes\n",
+			flush_page_cnt, flush_write_cnt);
+	printf ("Aging: %lld sampling passes, %lld of %lld victims cold\n",
+			age_pass_cnt, evict_cold_cnt, evict_cnt);
+	printf ("Reaper: %lld address spaces, %lld pages in %lld batches\n",
+			reap_proc_cnt, reap_page_cnt, reap_batch_cnt);
+	printf ("Startup prefetch: %lld traces, %lld pages in %lld reads\n",
+			startup_trace_cnt, startup_page_cnt, startup_read_cnt);
+	printf ("Mlock: %zu pages locked, %lld pages of I/O done in place\n",
+			mlock_cnt, mlock_io_cnt);
+	printf ("Page merging: %lld passes, %lld frames checksummed in %lld "
+			"cycles, %lld pages merged, %lld false matches\n",
+			merge_pass_cnt, merge_scan_cnt, merge_cycles, merge_page_cnt,
+			merge_miss_cnt);
+	slab_print_stats (&page_pool);
+	vm_print_fault_stats ();
+	anon_print_stats ();
+	page_cache_print_stats ();
+}
+
+/* Returns PAGE's lazy load info if it is still waiting to be
+ * loaded from a file (an ELF segment or mmap page), otherwise a
+ * null pointer. */
+static struct lazy_load_info *
+lazy_file_info (struct page *page) {
+	if (VM_TYPE (page->operations->type) != VM_UNINIT
+			|| page->uninit.init == NULL)
+		return NULL;
+	return &page->uninit.lazy;
+}
+
+/* Returns true if PAGE is still to be loaded and would start out
+ * as an anonymous page full of zeros: a stack page, a page of
+ * bss, or a plain anonymous allocation. */
+static bool
+zero_fill_page (struct page *page) {
+	struct lazy_load_info *info;
+
+	if (VM_TYPE (page->operations->type) != VM_UNINIT
+			|| VM_TYPE (page->uninit.type) != VM_ANON)
+		return false;
+	info = lazy_file_info (page);
+	return info == NULL || info->page_read_bytes == 0;
+}
+
+/* Turns PAGE, which must satisfy zero_fill_page(), into an
+ * anonymous page and maps the shared zero page read-only in its
+ * place. */
+static bool
+vm_map_zero_page (struct page *page) {
+	if (!uninit_preload (page, zero_page))
+		return false;
+	page->pml4 = thread_current ()->pml4;
+	if (!pml4_set_page (page->pml4, page->va, zero_page, false))
+		return false;
+	zero_map_cnt++;
+	return true;
+}
+
+/* Hash and comparison functions for the text cache. */
+static uint64_t
+frame_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *f = hash_entry (e, struct frame, cache_elem);
+	return (uint64_t) f->inode ^ ((uint64_t) f->offset << 16) ^ f->length;
+}
+
+static bool
+frame_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry (a_, struct frame, cache_elem);
+	const struct frame *b = hash_entry (b_, struct frame, cache_elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->offset != b->offset)
+		return a->offset < b->offset;
+	return a->length < b->length;
+}
+
+/* Sets the text cache key of KEY to that of PAGE, which must be
+ * executable text, loaded or not. */
+static void
+text_key (struct page *page, struct frame *key) {
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		struct lazy_load_info *info = &page->uninit.lazy;
+		key->inode = file_get_inode (info->file);
+		key->offset = info->offset;
+		key->length = info->page_read_bytes;
+	} else {
+		key->inode = page->file.inode;
+		key->offset = page->file.offset;
+		key->length = page->file.length;
+	}
+}
+
+/* Returns the cached frame with KEY's contents, or a null pointer.
+ * Must be called with frame_lock held. */
+static struct frame *
+text_cache_find (struct frame *key) {
+	struct hash_elem *e = ohash_find (&text_cache, &key->cache_elem);
+	return e != NULL ? hash_entry (e, struct frame, cache_elem) : NULL;
+}
+
+/* Returns true if the text cache holds the contents of PAGE. */
+static bool
+text_cached (struct page *page) {
+	struct frame key;
+	bool cached;
+
+	text_key (page, &key);
+	lock_acquire (&frame_lock);
+	cached = text_cache_find (&key) != NULL;
+	lock_release (&frame_lock);
+	return cached;
+}
+
+/* Enters the frame PAGE, executable text, was just loaded into in
+ * the text cache, unless another process got there first. */
+static void
+text_cache_add (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	frame = page->frame;
+	if (frame != NULL && !frame->evicting && frame->inode == NULL) {
+		text_key (page, frame);
+		if (ohash_insert (&text_cache, &frame->cache_elem) != NULL)
+			frame->inode = NULL;
+	}
+	lock_release (&frame_lock);
+}
+
+/* Claims PAGE, a page of executable text, by mapping the frame
+ * another process already loaded it into, if there is one, and
+ * loading it into a new cached frame otherwise.  Sets *MAJOR to
+ * whether it had to be loaded. */
+static bool
+vm_claim_text_page (struct page *page, bool *major) {
+	struct frame key, *frame;
+	bool succ = true;
+
+	text_key (page, &key);
+	lock_acquire (&frame_lock);
+	frame = text_cache_find (&key);
+	/* Without memory to enter it in the rmap, the page gets a copy
+	 * of its own. */
+	if (frame != NULL && !rmap_add (&frame->rmap, page))
+		frame = NULL;
+	if (frame != NULL) {
+		/* Transmute while holding the lock, so that the evictor never
+		 * sees an uninit page on the frame. */
+		if (VM_TYPE (page->operations->type) == VM_UNINIT)
+			succ = uninit_preload (page, frame->kva);
+		page->frame = frame;
+		page->pml4 = thread_current ()->pml4;
+		pml4_set_page (page->pml4, page->va, frame->kva, false);
+		text_hit_cnt++;
+	}
+	lock_release (&frame_lock);
+	*major = frame == NULL;
+	if (frame != NULL)
+		return succ;
+
+	if (!vm_do_claim_page (page))
+		return false;
+	text_cache_add (page);
+	return true;
+}
+
+/* Adds PAGE, about to be loaded, to the current process's startup
+ * trace if it is recording one and PAGE holds executable data. */
+static void
+startup_note (struct page *page) {
+	struct startup_trace *rec = thread_current ()->startup;
+	struct lazy_load_info *info = lazy_file_info (page);
+
+	if (rec == NULL || rec->cnt == STARTUP_TRACE_MAX
+			|| info == NULL || info->page_read_bytes == 0
+			|| file_get_inode (info->file) != rec->inode)
+		return;
+	rec->va[rec->cnt++] = page->va;
+}
+
+/* Loads and maps the pages after VA, the page that just faulted,
+ * that are still waiting for consecutive data of the same file,
+ * up to WINDOW pages in all. */
+static void
+vm_fault_around (void *va, size_t window) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *pages[FAULT_AROUND_MAX];
+	struct frame *frames[FAULT_AROUND_MAX];
+	struct lazy_load_info *first = NULL;
+	size_t cnt = 0, bytes = 0;
+
+	while (cnt + 1 < window) {
+		struct page *page = spt_find_page (spt, va + (cnt + 1) * PGSIZE);
+		struct lazy_load_info *info = page ? lazy_file_info (page) : NULL;
+
+		/* Stop at a hole, at pure zero pages, and where the file data
+		 * stops being contiguous. */
+		if (info == NULL || info->page_read_bytes == 0)
+			break;
+		/* Text another process has loaded is shared on its own fault. */
+		if (page_is_text (page) && text_cached (page))
+			break;
+		if (first != NULL
+				&& (file_get_inode (info->file) != file_get_inode (first->file)
+					|| info->offset != first->offset + (off_t) (cnt * PGSIZE)))
+			break;
+		if ((frames[cnt] = frame_alloc (false)) == NULL)
+			break;
+
+		if (first == NULL)
+			first = info;
+		startup_note (page);
+		pages[cnt++] = page;
+		bytes += info->page_read_bytes;
+		if (info->page_read_bytes < PGSIZE)
+			break;
+	}
+	if (cnt > 0 && vm_preload (pages, frames, cnt, bytes))
+		fault_around_cnt += cnt;
+}
+
+/* Loads PAGES, CNT pages still waiting for consecutive data of the
+ * same file, BYTES in all, into FRAMES, fresh frames from
+ * frame_alloc(), with one read through fault_around_buf, and maps
+ * them.  On failure, frees the frames of the pages not mapped yet
+ * and leaves those to fault in on their own. */
+static bool
+vm_preload (struct page **pages, struct frame **frames, size_t cnt,
+		size_t bytes) {
+	struct lazy_load_info *first = &pages[0]->uninit.lazy;
+	uint64_t *pml4 = thread_current ()->pml4;
+	size_t i, mapped;
+
+	ASSERT (cnt < FAULT_AROUND_MAX && bytes <= cnt * PGSIZE);
+
+	lock_acquire (&fault_around_lock);
+	if (file_read_at (first->file, fault_around_buf, bytes, first->offset)
+			!= (off_t) bytes) {
+		lock_release (&fault_around_lock);
+		for (i = 0; i < cnt; i++)
+			frame_discard (frames[i]);
+		return false;
+	}
+	for (i = 0; i < cnt; i++) {
+		struct lazy_load_info *info = &pages[i]->uninit.lazy;
+		memcpy (frames[i]->kva, fault_around_buf + i * PGSIZE,
+				info->page_read_bytes);
+		memset (frames[i]->kva + info->page_read_bytes, 0,
+				PGSIZE - info->page_read_bytes);
+	}
+	lock_release (&fault_around_lock);
+
+	/* Published and transmuted under the lock, like a text page in
+	 * vm_claim_text_page(), so that nobody sees a page half set up
+	 * or an uninit page on a frame. */
+	lock_acquire (&frame_lock);
+	for (mapped = 0; mapped < cnt; mapped++) {
+		struct page *page = pages[mapped];
+		struct frame *frame = frames[mapped];
+
+		page->pml4 = pml4;
+		if (!rmap_add (&frame->rmap, page))
+			break;
+		page->frame = frame;
+		uninit_preload (page, frame->kva);
+		pml4_set_page (pml4, page->va, frame->kva, page->writable);
+		frame->pinned = false;
+	}
+	lock_release (&frame_lock);
+
+	for (i = mapped; i < cnt; i++)
+		frame_discard (frames[i]);
+	for (i = 0; i < mapped; i++)
+		if (page_is_text (pages[i]))
+			text_cache_add (pages[i]);
+	return mapped == cnt;
+}
+
+/* Returns the startup trace of INODE, or a null pointer.  Must be
+ * called with startup_lock held. */
+static struct startup_trace *
+startup_lookup (struct inode *inode) {
+	size_t i;
+
+	for (i = 0; i < STARTUP_TABLE_MAX; i++)
+		if (startup_table[i] != NULL && startup_table[i]->inode == inode)
+			return startup_table[i];
+	return NULL;
+}
+
+/* Orders pages still to be loaded by file offset, for qsort(). */
+static int
+startup_compare (const void *a_, const void *b_) {
+	const struct page *a = *(struct page * const *) a_;
+	const struct page *b = *(struct page * const *) b_;
+
+	return a->uninit.lazy.offset < b->uninit.lazy.offset ? -1
+		: a->uninit.lazy.offset > b->uninit.lazy.offset;
+}
+
+/* Loads the CNT PAGES of a startup trace, sorted by file offset. */
+static void
+startup_prefetch (struct page **pages, size_t cnt) {
+	struct frame *frames[FAULT_AROUND_MAX];
+	size_t i = 0;
+
+	while (i < cnt) {
+		struct lazy_load_info *first = lazy_file_info (pages[i]);
+		size_t run = 0, bytes = 0;
+		bool major;
+
+		/* Loaded already, as a page listed twice may be. */
+		if (first == NULL) {
+			i++;
+			continue;
+		}
+		/* Mapping the text cache's frame takes no read. */
+		if (page_is_text (pages[i]) && text_cached (pages[i])) {
+			vm_claim_text_page (pages[i], &major);
+			i++;
+			continue;
+		}
+
+		while (i + run < cnt && run < FAULT_AROUND_MAX - 1) {
+			struct page *page = pages[i + run];
+			struct lazy_load_info *info = lazy_file_info (page);
+
+			if (info == NULL
+					|| info->offset != first->offset + (off_t) (run * PGSIZE)
+					|| (page_is_text (page) && text_cached (page)))
+				break;
+			if ((frames[run] = frame_alloc (false)) == NULL)
+				break;
+			run++;
+			bytes += info->page_read_bytes;
+			if (info->page_read_bytes < PGSIZE)
+				break;
+		}
+		/* Out of free frames: the rest fault in as usual. */
+		if (run == 0 || !vm_preload (pages + i, frames, run, bytes))
+			return;
+		startup_page_cnt += run;
+		startup_read_cnt++;
+		i += run;
+	}
+}
+
+/* Starts the current process, which has just loaded EXE, on its
+ * startup trace: prefetches the pages a previous run of EXE faulted
+ * in first, or else records them for later runs. */
+void
+vm_startup_begin (struct file *exe) {
+	struct thread *t = thread_current ();
+	struct inode *inode = file_get_inode (exe);
+	struct startup_trace *trace;
+	struct page **pages = NULL;
+	size_t cnt = 0, i;
+
+	ASSERT (t->startup == NULL);
+	if (fault_around_buf == NULL)
+		return;
+
+	lock_acquire (&startup_lock);
+	trace = startup_lookup (inode);
+	if (trace != NULL) {
+		trace->stamp = ++startup_clock;
+		pages = malloc (trace->cnt * sizeof *pages);
+		for (i = 0; pages != NULL && i < trace->cnt; i++) {
+			struct page *page = spt_find_page (&t->spt, trace->va[i]);
+			struct lazy_load_info *info = page ? lazy_file_info (page) : NULL;
+
+			if (info != NULL && info->page_read_bytes > 0
+					&& file_get_inode (info->file) == inode)
+				pages[cnt++] = page;
+		}
+	}
+	lock_release (&startup_lock);
+
+	if (trace == NULL) {
+		t->startup = malloc (sizeof *t->startup);
+		if (t->startup != NULL) {
+			t->startup->inode = inode_reopen (inode);
+			t->startup->cnt = 0;
+		}
+		return;
+	}
+	qsort (pages, cnt, sizeof *pages, startup_compare);
+	startup_prefetch (pages, cnt);
+	free (pages);
+}
+
+/* Ends the current process's startup trace, if it is recording one,
+ * and keeps the trace for later runs of its executable in place of
+ * the one used least recently. */
+void
+vm_startup_end (void) {
+	struct thread *t = thread_current ();
+	struct startup_trace *rec = t->startup, *old = rec;
+	size_t i, victim = 0;
+
+	if (rec == NULL)
+		return;
+	t->startup = NULL;
+
+	lock_acquire (&startup_lock);
+	if (rec->cnt > 0 && startup_lookup (rec->inode) == NULL) {
+		for (i = 0; i < STARTUP_TABLE_MAX; i++) {
+			if (startup_table[i] == NULL) {
+				victim = i;
+				break;
+			}
+			if (startup_table[i]->stamp < startup_table[victim]->stamp)
+				victim = i;
+		}
+		old = startup_table[victim];
+		rec->stamp = ++startup_clock;
+		startup_table[victim] = rec;
+		startup_trace_cnt++;
+	}
+	lock_release (&startup_lock);
+
+	if (old != NULL) {
+		inode_close (old->inode);
+		free (old);
+	}
+}
+
+/* Ages the pages of a sequential region one fault-around window
+ * behind VA, the page that just faulted, so that the clock takes
+ * them before pages that may still be used. */
+static void
+vm_deactivate_behind (void *va) {
+	struct thread *t = thread_current ();
+	size_t i;
+
+	for (i = FAULT_AROUND_MAX; i < 2 * FAULT_AROUND_MAX; i++) {
+		void *behind = va - i * PGSIZE;
+		struct page *page;
+
+		if ((uint64_t) va < i * PGSIZE)
+			break;
+		page = spt_find_page (&t->spt, behind);
+		if (page != NULL && page->frame != NULL)
+			pml4_set_accessed (t->pml4, behind, false);
+	}
+}
+
+/* Starts reading PAGE in ahead of use, for MADV_WILLNEED.  File
+ * data is read into the page cache in the background; an anonymous
+ * page out in swap is brought back now. */
+static void
+vm_prefetch_page (struct page *page) {
+	struct lazy_load_info *info = lazy_file_info (page);
+	enum vm_type type = VM_TYPE (page->operations->type);
+
+	if (info != NULL) {
+		if (info->page_read_bytes > 0)
+			page_cache_prefetch (file_get_inode (info->file), info->offset,
+					info->page_read_bytes);
+	} else if (page->frame == NULL && type == VM_FILE) {
+		struct file_page *file_page = &page->file;
+		struct inode *inode = page_is_text (page) ? file_page->inode
+			: file_get_inode (file_page->file);
+		page_cache_prefetch (inode, file_page->offset, file_page->length);
+	} else if (page->frame == NULL && type == VM_ANON
+			&& page->anon.swap_slot != BITMAP_ERROR)
+		vm_do_claim_page (page);
+}
+
+/* Drops PAGE's frame, for MADV_DONTNEED.  A file page is written
+ * back first if it is dirty and reads back from its file; an
+ * anonymous page loses its contents and reads back as zeros.  An
+ * mlocked page is left alone. */
+static void
+vm_drop_page (struct page *page) {
+	enum vm_type type = VM_TYPE (page->operations->type);
+
+	if (type == VM_UNINIT || page->mlocked)
+		return;
+
+	/* The dirty bit survives pml4_clear_page(), as in eviction. */
+	lock_acquire (&frame_lock);
+	page_wait_evicted (page);
+	pml4_clear_page (thread_current ()->pml4, page->va);
+	if (page->frame != NULL && type == VM_FILE)
+		swap_out (page);
+	lock_release (&frame_lock);
+
+	vm_free_frame (page);
+	if (type == VM_ANON)
+		anon_discard (page);
+}
+
+/* Applies ADVICE, one of the MADV_* values, to the pages from ADDR,
+ * which must be page-aligned, to ADDR + LENGTH.  All of them must
+ * be in the supplemental page table.  Returns 0 if successful, -1
+ * otherwise. */
+int
+vm_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *end = pg_round_up ((uint64_t) addr + length);
+	void *va;
+
+	if (pg_ofs (addr) != 0 || end < addr
+			|| advice < MADV_NORMAL || advice > MADV_DONTNEED)
+		return -1;
+	for (va = addr; va < end; va += PGSIZE)
+		if (!is_user_vaddr (va) || spt_find_page (spt, va) == NULL)
+			return -1;
+
+	for (va = addr; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+
+		switch (advice) {
+			case MADV_WILLNEED:
+				vm_prefetch_page (page);
+				break;
+			case MADV_DONTNEED:
+				vm_drop_page (page);
+				break;
+			default:
+				page->advice = advice;
+				break;
+		}
+	}
+	return 0;
+}
+
+/* Orders dirty mapped pages by file, then by offset. */
+static int
+flush_compare (const void *a_, const void *b_) {
+	const struct flush_rec *a = a_;
+	const struct flush_rec *b = b_;
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode ? -1 : 1;
+	if (a->offset != b->offset)
+		return a->offset < b->offset ? -1 : 1;
+	return 0;
+}
+
+/* Returns true if page B continues, in the same file, the data of
+ * page A. */
+static bool
+flush_contiguous (const struct flush_rec *a, const struct flush_rec *b) {
+	return a->inode == b->inode
+		&& a->length == PGSIZE
+		&& a->offset + PGSIZE == b->offset;
+}
+
+/* Writes the CNT contiguous pages from RECS back with one write. */
+static void
+flush_cluster (struct flush_rec *recs, size_t cnt) {
+	size_t length = (cnt - 1) * PGSIZE + recs[cnt - 1].length;
+	void *buf = recs[0].frame->kva;
+	size_t i;
+
+	if (cnt > 1) {
+		buf = flush_buf;
+		for (i = 0; i < cnt; i++)
+			memcpy (flush_buf + i * PGSIZE, recs[i].frame->kva, recs[i].length);
+	}
+	inode_write_at (recs[0].inode, buf, length, recs[0].offset);
+	flush_write_cnt++;
+	flush_page_cnt += cnt;
+}
+
+/* Writes back the pages gathered in flush_batch, clustered, unpins
+ * their frames and empties it.  Must be called with flush_lock
+ * held, but not frame_lock. */
+static void
+flush_batch_write (void) {
+	size_t start, end, i;
+
+	qsort (flush_batch, flush_cnt, sizeof *flush_batch, flush_compare);
+	for (start = 0; start < flush_cnt; start = end) {
+		end = start + 1;
+		while (end < flush_cnt && end - start < FLUSH_CLUSTER_MAX
+				&& flush_contiguous (&flush_batch[end - 1], &flush_batch[end]))
+			end++;
+		flush_cluster (flush_batch + start, end - start);
+	}
+
+	/* Frames whose pages went away during the write are ours to
+	 * free. */
+	lock_acquire (&frame_lock);
+	for (i = 0; i < flush_cnt; i++) {
+		struct frame *frame = flush_batch[i].frame;
+
+		frame->pinned = false;
+		if (frame_put (frame))
+			palloc_free_page (frame->kva);
+	}
+	lock_release (&frame_lock);
+	for (i = 0; i < flush_cnt; i++)
+		inode_close (flush_batch[i].inode);
+	flush_cnt = 0;
+}
+
+/* Adds PAGE to flush_batch if it is a resident page of a file
+ * mapping with unsaved writes, clearing its dirty bit so that a
+ * write to it while it is being saved is caught by the next flush.
+ * A page whose frame is pinned, being loaded or shared with a page
+ * already in the batch, is left for the next flush.  Returns false
+ * if the batch is full, without adding PAGE; the caller writes the
+ * batch back and tries again.  Must be called with flush_lock and
+ * frame_lock held. */
+static bool
+flush_add (struct page *page) {
+	struct flush_rec *rec;
+
+	if (page->operations->type != VM_FILE || page->frame == NULL
+			|| page->frame->pinned || !pml4_is_dirty (page->pml4, page->va))
+		return true;
+	if (flush_cnt == FLUSH_BATCH)
+		return false;
+
+	pml4_set_dirty (page->pml4, page->va, false);
+	page->frame->pinned = true;
+	rec = &flush_batch[flush_cnt++];
+	rec->frame = page->frame;
+	rec->inode = inode_reopen (file_get_inode (page->file.file));
+	rec->offset = page->file.offset;
+	rec->length = page->file.length;
+	return true;
+}
+
+/* Adds PAGE to flush_batch, writing the batch back first if it is
+ * full.  Must be called with flush_lock and frame_lock held; the
+ * latter is released during the write. */
+static void
+flush_page (struct page *page) {
+	while (!flush_add (page)) {
+		lock_release (&frame_lock);
+		flush_batch_write ();
+		lock_acquire (&frame_lock);
+	}
+}
+
+/* Flusher thread: periodically writes back every dirty page of a
+ * file mapping in the frame table.  When the batch fills up, it is
+ * written and the scan starts over, since the frame table may
+ * change meanwhile; the pages already written are clean by then. */
+static void
+vm_flushd (void *aux UNUSED) {
+	for (;;) {
+		bool full;
+
+		timer_sleep (FLUSH_TICKS);
+		lock_acquire (&flush_lock);
+		do {
+			struct list_elem *f;
+
+			full = false;
+			lock_acquire (&frame_lock);
+			for (f = list_begin (&frame_table);
+					f != list_end (&frame_table) && !full; f = list_next (f)) {
+				struct frame *frame = list_entry (f, struct frame, elem);
+				struct rmap_iter i;
+				struct page *page;
+
+				for (page = rmap_first (&frame->rmap, &i); page != NULL && !full;
+						page = rmap_next (&i))
+					full = !flush_add (page);
+			}
+			lock_release (&frame_lock);
+			flush_batch_write ();
+		} while (full);
+		lock_release (&flush_lock);
+	}
+}
+
+/* Writes the dirty pages of file mappings from ADDR, which must be
+ * page-aligned, to ADDR + LENGTH back to their files.  All of them
+ * must be in the supplemental page table; other pages in the range
+ * are skipped.  Returns 0 if successful, -1 otherwise. */
+int
+vm_msync (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *end = pg_round_up ((uint64_t) addr + length);
+	void *va;
+
+	if (pg_ofs (addr) != 0 || end < addr)
+		return -1;
+	for (va = addr; va < end; va += PGSIZE)
+		if (!is_user_vaddr (va) || spt_find_page (spt, va) == NULL)
+			return -1;
+
+	lock_acquire (&flush_lock);
+	lock_acquire (&frame_lock);
+	for (va = addr; va < end; va += PGSIZE)
+		flush_page (spt_find_page (spt, va));
+	lock_release (&frame_lock);
+	flush_batch_write ();
+	lock_release (&flush_lock);
+	return 0;
+}
+
+/* Copies the SIZE bytes at BUF, just written to INODE at OFFSET,
+ * into the resident pages of file mappings that cover them.  Returns
+ * false, without finishing, if one of those pages was being evicted
+ * and its write-back may have landed on top of the new bytes; the
+ * caller writes them again and calls this once more.  Must be called
+ * with frame_lock held. */
+static bool
+mapped_pages_update (struct inode *inode, const void *buf, off_t size,
+		off_t offset) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame_table); e != list_end (&frame_table);
+			e = list_next (e)) {
+		struct frame *frame = list_entry (e, struct frame, elem);
+		struct rmap_iter i;
+		struct page *page;
+
+		for (page = rmap_first (&frame->rmap, &i); page != NULL;
+				page = rmap_next (&i)) {
+			struct file_page *fp = &page->file;
+			off_t lo, hi;
+
+			if (page->operations->type != VM_FILE || page->dead
+					|| file_get_inode (fp->file) != inode)
+				continue;
+			lo = offset > fp->offset ? offset : fp->offset;
+			hi = offset + size < fp->offset + (off_t) fp->length
+				? offset + size : fp->offset + (off_t) fp->length;
+			if (lo >= hi)
+				continue;
+			if (frame->evicting) {
+				page_wait_evicted (page);
+				return false;
+			}
+			/* One copy serves every page sharing the frame. */
+			memmove (frame->kva + (lo - fp->offset), buf + (lo - offset),
+					hi - lo);
+			break;
+		}
+	}
+	return true;
+}
+
+/* Writes SIZE bytes from BUF to FILE at its position, like
+ * file_write(), for write().  File mappings do not share frames with
+ * the page cache, so if FILE is mapped the new bytes are also copied
+ * into the resident pages of its mappings, which would otherwise
+ * show stale data until they are evicted and read back.  Holding
+ * flush_lock keeps a flush from writing those pages' old contents
+ * over the new bytes meanwhile.  A page being loaded while this runs
+ * may still read the file from before the write, as it may with any
+ * write that races a read. */
+off_t
+vm_file_write (struct file *file, const void *buf, off_t size) {
+	struct inode *inode = file_get_inode (file);
+	off_t offset = file_tell (file);
+	off_t written;
+
+	if (!inode_is_mapped (inode))
+		return file_write (file, buf, size);
+
+	lock_acquire (&flush_lock);
+	written = file_write (file, buf, size);
+	lock_acquire (&frame_lock);
+	while (!mapped_pages_update (inode, buf, written, offset)) {
+		lock_release (&frame_lock);
+		file_write_at (file, buf, written, offset);
+		lock_acquire (&frame_lock);
+	}
+	lock_release (&frame_lock);
+	lock_release (&flush_lock);
+	return written;
+}
+
+/* Returns the current process's working-set estimate: how many of
+ * its pages are resident and were used within the last WS_AGE
+ * sampling periods. */
+size_t
+vm_working_set (void) {
+	struct ohash_iterator i;
+	size_t cnt = 0;
+
+	lock_acquire (&frame_lock);
+	ohash_first (&i, &thread_current ()->spt.spt_hash);
+	while (ohash_next (&i)) {
+		struct page *page = hash_entry (ohash_cur (&i), struct page, hash_elem);
+		if (page->frame != NULL && page->frame->age < WS_AGE)
+			cnt++;
+	}
+	lock_release (&frame_lock);
+	return cnt;
 }
 
 /* Growing the stack. */
 static void
 vm_stack_growth (void *addr UNUSED) {
+	// the fault handler claims (or zero-maps) the new page itself
 	if (vm_alloc_page(VM_ANON | VM_MARKER_0, addr, true))
-	{
-		vm_claim_page(addr);
 		thread_current()->stack_bottom -= PGSIZE;
-	}
 	// 익명 페이지로 스택임을 확인할 수 있게 해서 페이지 할당 
 
 }
 
 /* Handle the fault on write_protected page */
+// only called for pages that are writable in the SPT, so the page is
+// copy-on-write: take a private copy of the frame unless PAGE is the
+// last one sharing it, in which case it can simply be made writable.
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	struct frame *old, *new;
+	bool evicted, succ = true;
+
+	lock_acquire (&frame_lock);
+	page_wait_evicted (page);
+	old = page->frame;
+	if (old != NULL && rmap_count (&old->rmap) == 1) {
+		pml4_set_writable (page->pml4, page->va, true);
+		lock_release (&frame_lock);
+		return true;
+	}
+	lock_release (&frame_lock);
+
+	new = vm_get_frame ();
+
+	// the old frame may have been evicted while we got the new one
+	lock_acquire (&frame_lock);
+	page_wait_evicted (page);
+	if (!rmap_add (&new->rmap, page)) {
+		lock_release (&frame_lock);
+		frame_discard (new);
+		return false;
+	}
+	old = page->frame;
+	evicted = old == NULL;
+	if (!evicted) {
+		memcpy (new->kva, old->kva, PGSIZE);
+		rmap_remove (&old->rmap, page);
+		if (!frame_put (old))
+			old = NULL;
+	}
+	page->frame = new;
+	lock_release (&frame_lock);
+
+	if (old != NULL)
+		palloc_free_page (old->kva);
+
+	pml4_set_page (page->pml4, page->va, new->kva, true);
+	if (evicted)
+		succ = swap_in (page, new->kva);
+	new->pinned = false;
+	return succ;
+}
+
+/* Adds a fault of KIND that took CYCLES to serve to the statistics
+ * of the current process and of the whole system. */
+static void
+fault_account (enum fault_kind kind, uint64_t cycles) {
+	struct fault_stats *stats[2] = {
+		&fault_stats_all, thread_current ()->fault_stats,
+	};
+	enum intr_level old_level;
+	int b = 0, i;
+
+	while (b + 1 < FAULT_HIST_BUCKETS
+			&& cycles >> (b + FAULT_HIST_SHIFT + 1) != 0)
+		b++;
+
+	old_level = intr_disable ();
+	for (i = 0; i < 2; i++)
+		if (stats[i] != NULL) {
+			stats[i]->count[kind]++;
+			stats[i]->cycles[kind] += cycles;
+			stats[i]->hist[kind][b]++;
+		}
+	intr_set_level (old_level);
 }
 
+/* Gives the current process, which is being set up, page fault
+ * statistics of its own.  Returns false if memory runs out. */
+bool
+vm_fault_stats_init (void) {
+	struct thread *t = thread_current ();
+
+	ASSERT (t->fault_stats == NULL);
+	t->fault_stats = calloc (1, sizeof *t->fault_stats);
+	return t->fault_stats != NULL;
+}
+
+/* Frees the page fault statistics of the current process, which is
+ * exiting, printing them first if -fstats was given. */
+void
+vm_fault_stats_exit (void) {
+	struct thread *t = thread_current ();
+	struct fault_stats *s = t->fault_stats;
+
+	if (s == NULL)
+		return;
+	if (fault_stats_print)
+		printf ("%s: page faults: %llu minor, %llu major, %llu copy-on-write, "
+				"%llu stack growth, %llu invalid\n", t->name,
+				s->count[FAULT_MINOR], s->count[FAULT_MAJOR], s->count[FAULT_COW],
+				s->count[FAULT_STACK], s->count[FAULT_INVALID]);
+	t->fault_stats = NULL;
+	free (s);
+}
+
+/* Copies the page fault statistics of the current process, or of
+ * the whole system if ALL, into STATS, which may be in user
+ * memory. */
+void
+vm_fault_stats (struct fault_stats *stats, bool all) {
+	struct fault_stats *src = all ? &fault_stats_all
+		: thread_current ()->fault_stats;
+	struct fault_stats snap;
+	enum intr_level old_level;
+
+	memset (&snap, 0, sizeof snap);
+	old_level = intr_disable ();
+	if (src != NULL)
+		snap = *src;
+	intr_set_level (old_level);
+	memcpy (stats, &snap, sizeof snap);
+}
+
+static bool vm_handle_fault (struct intr_frame *f, void *addr, bool user,
+		bool write, bool not_present, enum fault_kind *kind);
+
 /* Return true on success */
+// times the fault and accounts it by the kind vm_handle_fault() found
 bool
 vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
+	uint64_t start = rdtsc ();
+	enum fault_kind kind = FAULT_INVALID;
+	bool succ = vm_handle_fault (f, addr, user, write, not_present, &kind);
+
+	fault_account (succ ? kind : FAULT_INVALID, rdtsc () - start);
+	return succ;
+}
+
+/* Handles a page fault, setting *KIND to what kind it was.  Returns
+ * true on success. */
+static bool
+vm_handle_fault (struct intr_frame *f, void *addr, bool user, bool write,
+		bool not_present, enum fault_kind *kind) {
 	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
 	struct page *page = NULL;
 	/* TODO: Validate the fault */
@@ -238,6 +1967,7 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		// Check stack size max limit and stack growth request heuristically
 		if((uint64_t)addr > STACK_LIMIT && USER_STACK > (uint64_t)addr && (uint64_t)addr > (uint64_t)rsp - GROWTH_LIMIT){
 			void *faddr = thread_current()->stack_bottom - PGSIZE;
+			*kind = FAULT_STACK;
 			vm_stack_growth (faddr);
 			fpage = spt_find_page(spt, faddr);
 		}
@@ -248,20 +1978,249 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 	else if(write && !fpage->writable){
 		return false;
 	}
+	else {
+		// a page being evicted is back in reach once it is saved
+		lock_acquire (&frame_lock);
+		page_wait_evicted (fpage);
+		lock_release (&frame_lock);
+	}
+	if(!not_present){
+		// present but write-protected: copy-on-write.  With CR0.WP set
+		// this is also where a kernel write such as copy_to_user() lands
+		*kind = FAULT_COW;
+		return write && vm_handle_wp (fpage);
+	}
 	ASSERT(fpage != NULL);
 
 	// Step 2~4.
-	bool gotFrame = vm_do_claim_page (fpage);
-
+	if (*kind != FAULT_STACK)
+		*kind = FAULT_MINOR;
+	if (!write && zero_fill_page (fpage))
+		return vm_map_zero_page (fpage);
+
+	// reading a file or swap is a major fault, a fresh page a minor one
+	struct lazy_load_info *info = lazy_file_info (fpage);
+	startup_note (fpage);
+	bool from_file = info != NULL;
+	bool major = VM_TYPE (fpage->operations->type) != VM_UNINIT
+		|| (from_file && info->page_read_bytes > 0);
+	bool gotFrame = page_is_text (fpage) ? vm_claim_text_page (fpage, &major)
+		: vm_do_claim_page (fpage);
+
+	if (major && *kind != FAULT_STACK)
+		*kind = FAULT_MAJOR;
+
+	if (gotFrame && fpage->advice == MADV_SEQUENTIAL)
+		vm_deactivate_behind (fpage->va);
+	if (gotFrame && from_file && fault_around_buf != NULL) {
+		size_t window = fpage->advice == MADV_SEQUENTIAL ? FAULT_AROUND_MAX
+			: fpage->advice == MADV_RANDOM ? 1 : fault_around_pages;
+		if (window > 1)
+			vm_fault_around (fpage->va, window);
+	}
 	return gotFrame;
 }
 
+/* Sets PAGE's mlocked flag to LOCK, keeping the counts of locked
+ * pages.  PAGE must belong to the current process.  Must be called
+ * with frame_lock held. */
+static void
+mlock_set (struct page *page, bool lock) {
+	struct thread *t = thread_current ();
+
+	if (page->mlocked == lock)
+		return;
+	page->mlocked = lock;
+	if (lock) {
+		mlock_cnt++;
+		t->mlock_cnt++;
+	} else {
+		mlock_cnt--;
+		t->mlock_cnt--;
+	}
+}
+
+/* Makes PAGE, which was just mlocked, resident, and gives it a
+ * frame of its own if it is writable, so that no fault is left to
+ * happen on it but at worst the write fault that turns a read-only
+ * mapping of its own frame writable.  Returns false if the page
+ * cannot be loaded. */
+static bool
+vm_populate_page (struct page *page) {
+	enum fault_kind kind = FAULT_INVALID;
+	bool present = pml4_get_page (page->pml4, page->va) != NULL;
+	bool shared;
+
+	lock_acquire (&frame_lock);
+	shared = page->frame == NULL || rmap_count (&page->frame->rmap) > 1;
+	lock_release (&frame_lock);
+	if (present && !(page->writable && shared))
+		return true;
+	return vm_handle_fault (NULL, page->va, false, page->writable, !present,
+			&kind);
+}
+
+/* Checks that the pages from ADDR, which must be page-aligned, to
+ * ADDR + LENGTH are all in the current process's supplemental page
+ * table, and sets *END to the end of the range and *CNT to how many
+ * of them are not mlocked.  Returns false if they are not. */
+static bool
+mlock_range (void *addr, size_t length, void **end, size_t *cnt) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *va;
+
+	*end = pg_round_up ((uint64_t) addr + length);
+	*cnt = 0;
+	if (pg_ofs (addr) != 0 || *end < addr)
+		return false;
+	for (va = addr; va < *end; va += PGSIZE) {
+		struct page *page;
+
+		if (!is_user_vaddr (va) || (page = spt_find_page (spt, va)) == NULL)
+			return false;
+		if (!page->mlocked)
+			(*cnt)++;
+	}
+	return true;
+}
+
+/* Returns true if the current process may mlock CNT more pages.
+ * Must be called with frame_lock held. */
+static bool
+mlock_allowed (size_t cnt) {
+	return thread_current ()->mlock_cnt + cnt <= MLOCK_PROC_MAX
+		&& mlock_cnt + cnt <= mlock_max_pages;
+}
+
+/* Locks the pages from ADDR, which must be page-aligned, to ADDR +
+ * LENGTH in memory: faults them in and keeps them from being
+ * evicted until they are unlocked or unmapped.  All of them must
+ * be in the supplemental page table.  Returns 0 if successful, -1
+ * otherwise, including when the process or the system would go
+ * over its limit of locked pages. */
+int
+vm_mlock (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t cnt;
+	void *end, *va;
+
+	if (!mlock_range (addr, length, &end, &cnt))
+		return -1;
+
+	/* Locked before they are loaded, so that loading the last ones
+	 * does not evict the first. */
+	lock_acquire (&frame_lock);
+	if (!mlock_allowed (cnt)) {
+		lock_release (&frame_lock);
+		return -1;
+	}
+	for (va = addr; va < end; va += PGSIZE)
+		mlock_set (spt_find_page (spt, va), true);
+	lock_release (&frame_lock);
+
+	for (va = addr; va < end; va += PGSIZE)
+		if (!vm_populate_page (spt_find_page (spt, va))) {
+			vm_munlock (addr, length);
+			return -1;
+		}
+	return 0;
+}
+
+/* Unlocks the pages from ADDR, which must be page-aligned, to ADDR
+ * + LENGTH, so that they may be evicted again.  All of them must
+ * be in the supplemental page table.  Returns 0 if successful, -1
+ * otherwise. */
+int
+vm_munlock (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t cnt;
+	void *end, *va;
+
+	if (!mlock_range (addr, length, &end, &cnt))
+		return -1;
+	lock_acquire (&frame_lock);
+	for (va = addr; va < end; va += PGSIZE)
+		mlock_set (spt_find_page (spt, va), false);
+	lock_release (&frame_lock);
+	return 0;
+}
+
+/* Locks every page of the current process in memory, as
+ * vm_mlock() does for a range.  Pages added later, such as by
+ * stack growth or mmap(), are not locked.  Returns 0 if
+ * successful, -1 otherwise, in which case no page is left locked. */
+int
+vm_mlockall (void) {
+	struct ohash *spt_hash = &thread_current ()->spt.spt_hash;
+	struct ohash_iterator i;
+	size_t cnt = 0;
+
+	lock_acquire (&frame_lock);
+	ohash_first (&i, spt_hash);
+	while (ohash_next (&i))
+		if (!hash_entry (ohash_cur (&i), struct page, hash_elem)->mlocked)
+			cnt++;
+	if (!mlock_allowed (cnt)) {
+		lock_release (&frame_lock);
+		return -1;
+	}
+	ohash_first (&i, spt_hash);
+	while (ohash_next (&i))
+		mlock_set (hash_entry (ohash_cur (&i), struct page, hash_elem), true);
+	lock_release (&frame_lock);
+
+	ohash_first (&i, spt_hash);
+	while (ohash_next (&i))
+		if (!vm_populate_page (hash_entry (ohash_cur (&i), struct page,
+						hash_elem))) {
+			lock_acquire (&frame_lock);
+			ohash_first (&i, spt_hash);
+			while (ohash_next (&i))
+				mlock_set (hash_entry (ohash_cur (&i), struct page, hash_elem),
+						false);
+			lock_release (&frame_lock);
+			return -1;
+		}
+	return 0;
+}
+
+/* Returns the kernel address of UADDR, a user address of the
+ * current process, if its page is mlocked and resident, so that
+ * the kernel can read it, or write it if WRITE, there instead of
+ * copying through the user mapping; the address stays good for as
+ * long as the page is locked, up to the end of the page.  Returns a
+ * null pointer otherwise, or if WRITE and the page is not writable
+ * or its frame is shared copy-on-write. */
+void *
+vm_mlocked_kva (const void *uaddr, bool write) {
+	struct page *page;
+	void *kva = NULL;
+
+	if (!is_user_vaddr (uaddr))
+		return NULL;
+	page = spt_find_page (&thread_current ()->spt, (void *) uaddr);
+	if (page == NULL || !page->mlocked)
+		return NULL;
+
+	lock_acquire (&frame_lock);
+	if (page->frame != NULL && (!write || (page->writable
+					&& rmap_count (&page->frame->rmap) == 1))) {
+		kva = page->frame->kva + pg_ofs (uaddr);
+		pml4_set_accessed (page->pml4, page->va, true);
+		if (write)
+			pml4_set_dirty (page->pml4, page->va, true);
+		mlock_io_cnt++;
+	}
+	lock_release (&frame_lock);
+	return kva;
+}
+
 /* Free the page.
  * DO NOT MODIFY THIS FUNCTION. */
 void
 vm_dealloc_page (struct page *page) {
 	destroy (page);
-	free (page);
+	slab_free (&page_pool, page);
 }
 
 /* Claim the page that allocate on VA. */
@@ -291,14 +2250,24 @@ vm_claim_page (void *va UNUSED) {
 static bool
 vm_do_claim_page (struct page *page) {
 	struct frame *frame = vm_get_frame ();
+	struct thread *cur = thread_current();
 
 	/* Set links */
-	frame->page = page;
+	// the page is complete before it goes on the rmap, where the
+	// other frame_lock users find it; the frame stays pinned while
+	// swap_in() below loads it
+	page->pml4 = cur->pml4;
+	lock_acquire (&frame_lock);
+	if (!rmap_add (&frame->rmap, page)) {
+		lock_release (&frame_lock);
+		frame_discard (frame);
+		return false;
+	}
 	page->frame = frame;
+	lock_release (&frame_lock);
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
 	// page와 frame에 저장된 실제 physical memory 주소 (kernel vaddr) 관계를 page table에 등록
-	struct thread *cur = thread_current();
 
 	// bool writable = is_writable((uint64_t *)frame->kva); // #ifdef DBG
 	bool writable = page->writable;
@@ -306,14 +2275,17 @@ vm_do_claim_page (struct page *page) {
 	pml4_set_page(cur->pml4, page->va, frame->kva, writable);
 	// add the mapping from the virtual address to the physical address in the page table.
 
-	return swap_in (page, frame->kva);
+	bool succ = swap_in (page, frame->kva);
+	frame->pinned = false;
+	return succ;
 }
 
 /* Initialize new supplemental page table */
 // Docs - Hash Table 코드 참고
-unsigned page_hash (const struct hash_elem *p_, void *aux UNUSED) {
+// ohash mixes the bits itself, so the page address is a good enough hash
+uint64_t page_hash (const struct hash_elem *p_, void *aux UNUSED) {
   const struct page *p = hash_entry (p_, struct page, hash_elem);
-  return hash_bytes (&p->va, sizeof p->va);
+  return (uint64_t) p->va;
 }
 
 bool page_less (const struct hash_elem *a_,
@@ -324,79 +2296,228 @@ bool page_less (const struct hash_elem *a_,
   return a->va < b->va;
 }
 
-void hash_action_copy (struct hash_elem *e, void *hash_aux){
-	struct thread *t = thread_current();
-	ASSERT(&t->spt == (struct supplemental_page_table *)hash_aux); // child's SPT
+/* Returns the child's counterpart of FILE, which pages of the
+ * parent, whose SPT is SRC, read: the file of the same mapping, or
+ * else the child's own executable. */
+static struct file *
+spt_copy_file (struct supplemental_page_table *src, struct file *file) {
+	struct file *copy = mmap_copy_file (&thread_current ()->spt, src, file);
 
-	struct page *page = hash_entry(e, struct page, hash_elem);
+	return copy != NULL ? copy : thread_current ()->running;
+}
+
+/* Copies PAGE of the parent, whose SPT is SRC, into the SPT of the
+ * current process, which is the child in the middle of fork.
+ * Returns false if memory for the copy runs out. */
+static bool
+spt_copy_page (struct supplemental_page_table *src, struct page *page) {
+	struct thread *t = thread_current();
 	enum vm_type type = page->operations->type; // type of page to copy
+	struct page *newpage;
+	bool in_swap;
 
 	if(type == VM_UNINIT){
 		struct uninit_page *uninit = &page->uninit;
 		vm_initializer *init = uninit->init;
-		void *aux = uninit->aux;
-	
-		// copy aux (struct lazy_load_info *)
-		struct lazy_load_info *lazy_load_info = malloc(sizeof(struct lazy_load_info));
-		if(lazy_load_info == NULL){
-			// #ifdef DBG
-			// kernel pool all used
-		}
-		memcpy(lazy_load_info, (struct lazy_load_info *)aux, sizeof(struct lazy_load_info));
+
+		// copy the lazy load info; the new page keeps its own copy
+		struct lazy_load_info lazy_load_info = uninit->lazy;
 
 	#ifdef DBG_SPT_COPY
-		printf("copy - offset %d\n", lazy_load_info->offset);
+		printf("copy - offset %d\n", lazy_load_info.offset);
 	#endif
 
-		lazy_load_info->file = file_reopen(((struct lazy_load_info *)aux)->file); // get new struct file (calloc)
-		vm_alloc_page_with_initializer(uninit->type, page->va, page->writable, init, lazy_load_info);
+		if (init != NULL)
+			lazy_load_info.file = spt_copy_file (src, uninit->lazy.file);
+		if (!vm_alloc_page_with_initializer(uninit->type, page->va,
+					page->writable, init, init != NULL ? &lazy_load_info : NULL))
+			return false;
+		spt_find_page(&t->spt, page->va)->advice = page->advice;
+		return true;
 	}
-	if(type & VM_ANON == VM_ANON){ // include stack pages
-		//when __do_fork is called, thread_current is the child thread so we can just use vm_alloc_page
-		vm_alloc_page(type, page->va, page->writable);
-
-
-		struct page *newpage = spt_find_page(&t->spt, page->va); // copied page
-		vm_do_claim_page(newpage);
-
-		ASSERT(page->frame != NULL);
-		memcpy(newpage->frame->kva, page->frame->kva, PGSIZE);
+	if(vm_share_page(page, &in_swap)) {
+		newpage = spt_find_page (&t->spt, page->va);
+		if (VM_TYPE (type) == VM_FILE && !page_is_text (newpage))
+			newpage->file.file = spt_copy_file (src, page->file.file);
+		return true;
 	}
-	// #ifdef DBG TODO
-	// file page -> duplicate file?
-	// don't understand file page yet
+	if (!in_swap)
+		return false;
+
+	// anon page in swap: copy it now
+	//when __do_fork is called, thread_current is the child thread so we can just use vm_alloc_page
+	if (!vm_alloc_page(type, page->va, page->writable))
+		return false;
+	newpage = spt_find_page(&t->spt, page->va); // copied page
+	newpage->advice = page->advice;
+	if (!vm_do_claim_page(newpage))
+		return false;
+	anon_swap_copy(page, newpage->frame->kva);
+	return true;
 }
 void hash_action_destroy (struct hash_elem *e, void *aux){
 	struct page *page = hash_entry(e, struct page, hash_elem);
 	destroy(page);
-	free(page->frame);
-	free(page);
+	vm_free_frame(page);
+	slab_free(&page_pool, page);
 }
 
 void
 supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
-	hash_init (&spt->spt_hash, page_hash, page_less, NULL);
+	ohash_init (&spt->spt_hash, page_hash, page_less, NULL);
+	list_init (&spt->mmaps);
 }
 
 /* Copy supplemental page table from src to dst */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
-	src->spt_hash.aux = dst; // pass 'dst' as aux to 'hash_apply'
-	hash_apply(&src->spt_hash, hash_action_copy);
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	struct ohash_iterator i;
+
+	ASSERT (dst == &thread_current ()->spt);
+
+	// a failed copy fails the fork, whose exit frees what was copied
+	if (!mmap_copy_all (dst, src))
+		return false;
+	ohash_first (&i, &src->spt_hash);
+	while (ohash_next (&i))
+		if (!spt_copy_page (src, hash_entry (ohash_cur (&i), struct page, hash_elem)))
+			return false;
 	return true;
 }
 
+/* Writes the file mappings still in SPT back like munmap() does,
+ * while the PTEs still tell which pages were modified. */
+static void
+spt_flush (struct supplemental_page_table *spt) {
+	struct ohash_iterator i;
+
+	lock_acquire (&flush_lock);
+	lock_acquire (&frame_lock);
+	ohash_first (&i, &spt->spt_hash);
+	while (ohash_next (&i))
+		flush_page (hash_entry (ohash_cur (&i), struct page, hash_elem));
+	lock_release (&frame_lock);
+	flush_batch_write ();
+	lock_release (&flush_lock);
+}
+
 /* Free the resource hold by the supplemental page table */
 void
 supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
-	/* TODO: Destroy all the supplemental_page_table hold by thread and
-	 * TODO: writeback all the modified contents to the storage. */
-	hash_destroy(&spt->spt_hash, hash_action_destroy);
+	spt_flush (spt);
+	ohash_destroy(&spt->spt_hash, hash_action_destroy);
+	mmap_close_all (spt);
+}
+
+/* Tears down the address space of the exiting process, SPT and
+ * PML4, which is no longer active.  File mappings are written back
+ * before this returns; the rest is left to the reaper thread. */
+void
+vm_reap (struct supplemental_page_table *spt, uint64_t *pml4) {
+	struct reap_req *req;
+	struct ohash_iterator i;
+
+	spt_flush (spt);
+	req = malloc (sizeof *req);
+	if (req == NULL) {
+		ohash_destroy (&spt->spt_hash, hash_action_destroy);
+		mmap_close_all (spt);
+		pml4_destroy (pml4);
+		return;
+	}
+
+	/* Until the reaper gets to them, eviction takes their frames
+	 * first and without saving them.  Once no eviction is still
+	 * writing one of them back, nothing reads the mapped files
+	 * again and they can be closed here. */
+	lock_acquire (&frame_lock);
+	ohash_first (&i, &spt->spt_hash);
+	while (ohash_next (&i))
+		hash_entry (ohash_cur (&i), struct page, hash_elem)->dead = true;
+	ohash_first (&i, &spt->spt_hash);
+	while (ohash_next (&i))
+		page_wait_evicted (hash_entry (ohash_cur (&i), struct page, hash_elem));
+	lock_release (&frame_lock);
+	mmap_close_all (spt);
+
+	req->spt = spt->spt_hash;
+	req->pml4 = pml4;
+	lock_acquire (&reap_lock);
+	list_push_back (&reap_list, &req->elem);
+	lock_release (&reap_lock);
+	sema_up (&reap_sema);
+}
+
+/* Frees the CNT dead pages in PAGES, with their frames unless some
+ * other process still shares them. */
+static void
+reap_batch (struct page **pages, size_t cnt) {
+	struct frame *dead[REAP_BATCH];
+	size_t dead_cnt = 0, i;
+
+	lock_acquire (&frame_lock);
+	for (i = 0; i < cnt; i++) {
+		struct frame *frame;
+
+		page_wait_evicted (pages[i]);
+		frame = pages[i]->frame;
+		if (pages[i]->mlocked)
+			mlock_cnt--;
+		if (frame == NULL)
+			continue;
+		rmap_remove (&frame->rmap, pages[i]);
+		pages[i]->frame = NULL;
+		if (frame_put (frame))
+			dead[dead_cnt++] = frame;
+	}
+	lock_release (&frame_lock);
+
+	for (i = 0; i < dead_cnt; i++)
+		palloc_free_page (dead[i]->kva);
+	for (i = 0; i < cnt; i++) {
+		destroy (pages[i]);
+		slab_free (&page_pool, pages[i]);
+	}
+	reap_page_cnt += cnt;
+	reap_batch_cnt++;
+}
+
+/* Reaper thread: tears down the address spaces of exited
+ * processes. */
+static void
+vm_reaperd (void *aux UNUSED) {
+	for (;;) {
+		struct page *batch[REAP_BATCH];
+		struct ohash_iterator i;
+		struct reap_req *req;
+		size_t cnt = 0;
+
+		sema_down (&reap_sema);
+		lock_acquire (&reap_lock);
+		req = list_entry (list_pop_front (&reap_list), struct reap_req, elem);
+		lock_release (&reap_lock);
+
+		ohash_first (&i, &req->spt);
+		while (ohash_next (&i)) {
+			batch[cnt++] = hash_entry (ohash_cur (&i), struct page, hash_elem);
+			if (cnt == REAP_BATCH) {
+				reap_batch (batch, cnt);
+				cnt = 0;
+			}
+		}
+		if (cnt > 0)
+			reap_batch (batch, cnt);
+		ohash_destroy (&req->spt, NULL);
+		pml4_destroy (req->pml4);
+		free (req);
+		reap_proc_cnt++;
+	}
 }
 
 // Used in process_exec - process_cleanup : don't destroy SPT when it will be used afterwards!
 void
 supplemental_page_table_clear (struct supplemental_page_table *spt UNUSED) {
-	hash_clear(&spt->spt_hash, hash_action_destroy);
+	ohash_clear(&spt->spt_hash, hash_action_destroy);
+	mmap_close_all (spt);
 }